@@ -1,6 +1,25 @@
 // Main class for the display controller
 //
 #include "amoled.h"
+#include "amoled_flush.h"
+#include "amoled_stage.h"
+#include "amoled_round.h"
+#include "amoled_shadow.h"
+#include "amoled_te.h"
+#include "trace.h"
+#include "esp_memory_utils.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+
+#if FLUSH_PROFILE
+#define PROFILE_NOW() ((uint32_t)esp_timer_get_time())
+#define PROFILE_ADD(field, value) (flushProf.field += (uint32_t)(value))
+#else
+#define PROFILE_NOW() 0u
+#define PROFILE_ADD(field, value) ((void)(value))
+#endif
 
 static const panel_lcd_init_cmd_t sh8601_lcd_init_cmds[] =
     {
@@ -18,8 +37,13 @@ static const panel_lcd_init_cmd_t co5300_lcd_init_cmds[] =
     {
         {0x11, (uint8_t[]){0x00}, 0, 80},
         {0xC4, (uint8_t[]){0x80}, 1, 0},
+#if TE_SYNC
+        {0x44, (uint8_t[]){0x01, 0xD1}, 2, 0}, // TE pulse at the last line (TE_SCANLINE)
+        {0x35, (uint8_t[]){0x00}, 1, 0},       // TE on
+#else
         //{0x44, (uint8_t []){0x01, 0xD1}, 2, 0},
         //{0x35, (uint8_t []){0x00}, 1, 0},//TE ON
+#endif
         {0x53, (uint8_t[]){0x20}, 1, 1},
         {0x63, (uint8_t[]){0xFF}, 1, 1},
         {0x51, (uint8_t[]){0x00}, 1, 1},
@@ -28,6 +52,29 @@ static const panel_lcd_init_cmd_t co5300_lcd_init_cmds[] =
         //{0x36, (uint8_t []){0x60}, 1, 0}, // Change screen orientation, touch reading must be adjusted
 };
 
+// Brightness `elapsed` into a fade of `duration` from `from` to `to`
+static uint8_t fade_level(uint8_t from, uint8_t to, uint32_t elapsed, uint32_t duration, AmoledFadeCurve curve)
+{
+  if (elapsed >= duration)
+    return to;
+  uint64_t t = (uint64_t)elapsed * 65536 / duration; // progress, 16-bit fixed point
+  switch (curve)
+  {
+  case AMOLED_FADE_EASE_IN:
+    t = t * t >> 16;
+    break;
+  case AMOLED_FADE_EASE_OUT:
+    t = 65536 - ((65536 - t) * (65536 - t) >> 16);
+    break;
+  case AMOLED_FADE_EASE_IN_OUT:
+    t = t * t * (3 * 65536 - 2 * t) >> 32;
+    break;
+  default:
+    break;
+  }
+  return (uint8_t)(from + (((int)to - (int)from) * (int64_t)t + 32768) / 65536);
+}
+
 // Convert byte to big endian
 static inline uint16_t toBE565(uint16_t c)
 {
@@ -37,16 +84,43 @@ static inline uint16_t toBE565(uint16_t c)
 Amoled::Amoled() {};
 Amoled::~Amoled()
 {
-  if (lineBuffer)
+  waitTransfers();
+  for (int i = 0; i < STRIP_BUFFERS; i++)
   {
-    free(lineBuffer);
-    lineBuffer = nullptr;
-    lineBufferSize = 0;
+    free(strips[i]);
+    strips[i] = nullptr;
   }
+  stripSize = 0;
+  if (stripsFree)
+  {
+    vSemaphoreDelete(stripsFree);
+    stripsFree = NULL;
+  }
+  free(shadowMem);
+  shadowMem = nullptr;
+  shadow_init(shadow, NULL);
+#if TE_SYNC && PIN_NUM_LCD_TE >= 0
+  if (teSignal)
+  {
+    gpio_isr_handler_remove((gpio_num_t)PIN_NUM_LCD_TE);
+    vSemaphoreDelete(teSignal);
+    teSignal = NULL;
+  }
+#endif
 }
 bool Amoled::begin()
 {
-  controller_id = read_lcd_id();
+#if AMOLED_CONTROLLER
+  // Built for one controller: no ID to read, the offset and the init table are constants
+  uint8_t id = AMOLED_CONTROLLER;
+#else
+  uint8_t id = 0;
+#endif
+  const bool probed = !id; // the ID read resets the panel on its own
+#if !AMOLED_CONTROLLER && CONTROLLER_ID_READ_GPIO
+  if (probed)
+    id = read_lcd_id(); // bit-banged, before the bus takes the pins
+#endif
   const spi_bus_config_t buscfg = AMOLED_PANEL_BUS_QSPI_CONFIG(PIN_NUM_LCD_PCLK,
                                                                PIN_NUM_LCD_DATA0,
                                                                PIN_NUM_LCD_DATA1,
@@ -55,6 +129,15 @@ bool Amoled::begin()
                                                                TRANSFER_SIZE);
   if (spi_bus_initialize(LCD_HOST, &buscfg, SPI_DMA_CH_AUTO) != ESP_OK)
     return false;
+#if !AMOLED_CONTROLLER
+#if !CONTROLLER_ID_READ_GPIO
+  // One SPI transaction on the bus, before the panel IO takes the CS line
+  if (probed && esp_amoled_read_id(LCD_HOST, &id) != ESP_OK)
+    return false;
+#endif
+  x_offset = amoled_controller(id).x_offset;
+#endif
+  controller_id = id;
   esp_lcd_panel_io_handle_t io_handle = NULL;
 
   const esp_lcd_panel_io_spi_config_t io_config = AMOLED_PANEL_IO_QSPI_CONFIG(PIN_NUM_LCD_CS, NULL, NULL);
@@ -74,36 +157,55 @@ bool Amoled::begin()
           .bits_per_pixel = LCD_BIT_PER_PIXEL,
           .vendor_config = &vendor_config,
       };
-  vendor_config.init_cmds = (controller_id == SH8601_ID) ? sh8601_lcd_init_cmds : co5300_lcd_init_cmds;
-  vendor_config.init_cmds_size = (controller_id == SH8601_ID) ? sizeof(sh8601_lcd_init_cmds) / sizeof(sh8601_lcd_init_cmds[0]) : sizeof(co5300_lcd_init_cmds) / sizeof(co5300_lcd_init_cmds[0]);
+  vendor_config.init_cmds = (id == SH8601_ID) ? sh8601_lcd_init_cmds : co5300_lcd_init_cmds;
+  vendor_config.init_cmds_size = (id == SH8601_ID) ? sizeof(sh8601_lcd_init_cmds) / sizeof(sh8601_lcd_init_cmds[0]) : sizeof(co5300_lcd_init_cmds) / sizeof(co5300_lcd_init_cmds[0]);
   if (esp_amoled_new_panel(io_handle, &panel_config, &panel_handle))
     return false;
-  if (esp_lcd_panel_reset(panel_handle))
+  // The ID read has just reset the panel
+  if (!probed && esp_lcd_panel_reset(panel_handle))
     return false;
   if (esp_lcd_panel_init(panel_handle))
     return false;
   if (esp_lcd_panel_disp_on_off(panel_handle, true))
     return false;
-  // reserve a single reusable scanline buffer equal to panel width
-  if (!reserveLineBuffer())
+  // reserve the ring of staging strips (STRIP_SIZE bytes of DMA-capable memory each)
+  if (!reserveStrips())
+    return false;
+  if (esp_amoled_panel_register_color_done_cb(panel_handle, onColorDone, this) != ESP_OK)
     return false;
+  // The shadow framebuffer is optional, without memory for it every pixel is sent
+  if (reserveShadow() && shadow.pixels)
+    fillScreen(AMOLED_COLOR_BLACK); // the panel memory holds garbage after reset, make it match the shadow
+  powerSince = sleepChanged = esp_timer_get_time(); // the init tables end with a sleep out
+#if TE_SYNC
+  // Without the TE line the flushes are simply not paced
+  if (!beginTearingEffect())
+    ESP_LOGW("amoled", "no tearing effect line (PIN_NUM_LCD_TE), flushes are not synchronised");
+#endif
   return true;
 }
 
-bool Amoled::drawBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h)
+bool Amoled::drawBitmap(int16_t x, int16_t y, const uint16_t *bitmap, int16_t w, int16_t h)
 {
-  if (!panel_handle || !bitmap || w <= 0 || h <= 0)
+  return drawBitmap(x, y, bitmap, w, 0, 0, w, h);
+}
+
+bool Amoled::drawBitmap(int16_t x, int16_t y, const uint16_t *src, int src_stride, int sx, int sy, int16_t w, int16_t h)
+{
+  if (!panel_handle || !src || w <= 0 || h <= 0 || sx < 0 || sy < 0 || src_stride < sx + w)
     return false;
 
-  // clip destination rect to screen
+  // Clip the destination to the screen, the source origin moves with it
   int dx = x, dy = y, cw = w, ch = h;
   if (dx < 0)
   {
+    sx -= dx;
     cw += dx;
     dx = 0;
   }
   if (dy < 0)
   {
+    sy -= dy;
     ch += dy;
     dy = 0;
   }
@@ -113,22 +215,43 @@ bool Amoled::drawBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16
     ch = DISPLAY_HEIGHT - dy;
   if (cw <= 0 || ch <= 0)
     return true; // nothing visible; treat as success
+#if TE_SYNC >= 2
+  waitScanLine(dy - 1, dy + ch + 1); // filler row included
+#endif
 
-  return pushToPanel(dx, dy, bitmap, w, h);
+  if (!reserveStrips() || stripSize < even_width(cw) * 2)
+    return false;
+  streamBottom = dy + ch + ((ch & 1) && dy + ch < DISPLAY_HEIGHT ? 1 : 0);
+  // The visible rows are staged straight from the source, nothing is read from it once this returns
+  return stageArea(dx, dy, cw, ch, src + (size_t)sy * src_stride + sx, src_stride, 0, false);
 }
 
-static inline int even_width(int w) { return (w & 1) ? (w + 1) : w; }
-
-bool Amoled::drawArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t *bitmap)
+bool Amoled::drawArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t *bitmap, int src_stride)
 {
+  TRACE_SCOPE("drawArea");
+  // Every return ends the profile of the call
+  profileBegin();
+  struct ProfileGuard
+  {
+    Amoled *self;
+    ~ProfileGuard() { self->profileEnd(); }
+  } profile_guard = {this};
+
   if (!panel_handle || !bitmap)
+  {
+    signalFlushDone();
     return false;
+  }
 
   // Inclusive source area
   int w = (int)x2 - (int)x1 + 1;
   int h = (int)y2 - (int)y1 + 1;
   if (w <= 0 || h <= 0)
+  {
+    signalFlushDone();
     return true;
+  }
+  const int stride = src_stride ? src_stride : w; // source row length, before clipping
 
   // Clip
   if (x1 < 0)
@@ -146,79 +269,922 @@ bool Amoled::drawArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16
   if (y1 + h > DISPLAY_HEIGHT)
     h = DISPLAY_HEIGHT - y1;
   if (w <= 0 || h <= 0)
+  {
+    signalFlushDone();
     return true;
+  }
+#if TE_SYNC >= 2
+  waitScanLine(y1 - 1, y1 + h + 1); // filler row included
+#endif
 
-  // Even width
-  int push_w = even_width(w);
-  bool pad_col = (push_w != w);
-
-  // Ensure line buffer holds 2 rows
-  if (!reserveLineBuffer())
-    return false;
-  if (lineBufferSize < push_w * 2)
+  // Ensure the strips hold at least 2 rows
+  const bool pad_col = (even_width(w) != w);
+  if (!reserveStrips() || stripSize < even_width(w) * 2)
+  {
+    signalFlushDone();
     return false;
+  }
+  stats.flushes++;
 
-  // Adjust for CO5300 X offset
-  int x_off = (controller_id == CO5300_ID) ? 6 : 0;
+  // Strips with the same columns continue one window down to the last row of the area (filler row included)
+  streamBottom = y1 + h + ((h & 1) && y1 + h < DISPLAY_HEIGHT ? 1 : 0);
 
-  for (int row = 0; row < h; row += 2)
+  // Zero-copy: rows are contiguous, already even-sized and the buffer is DMA-capable, so
+  // the even part of the area is byte-swapped in place and goes out in one transaction.
+  // The buffer must stay untouched until the flush-done callback (LVGL does not reuse it before).
+  // A strided source is a window of a buffer LVGL keeps drawing on (DIRECT mode): it is never swapped.
+  int row = 0;
+  if (!shadowMem && !pad_col && !src_stride && h >= 2 && esp_ptr_dma_capable(bitmap) && ((uintptr_t)bitmap & 3) == 0 &&
+      round_inside(x1, y1, w, h))
   {
-    int rows_this = (row + 1 < h) ? 2 : 1;
-
-    // Build 2 rows (duplicate last row if odd)
-    for (int r = 0; r < rows_this; r++)
+    row = h & ~1;
+    stats.zero_copy_flushes++;
+    const uint32_t t0 = PROFILE_NOW();
+    stage_swap_inplace(bitmap, w * row);
+    PROFILE_ADD(stage_us, PROFILE_NOW() - t0);
+    if (!pushToPanel(x1, y1, bitmap, w, row, (row == h) ? TRANSFER_END_OF_AREA : 0))
     {
-      const uint16_t *src = bitmap + (row + r) * w;
-      memcpy(lineBuffer + r * push_w, src, w * sizeof(uint16_t));
-      if (pad_col)
-        lineBuffer[r * push_w + (push_w - 1)] = src[w - 1];
+      if (row != h)
+        signalFlushDone();
+      return false;
     }
-    if (rows_this == 1)
-    { // duplicate last row
-      memcpy(lineBuffer + push_w, lineBuffer, push_w * sizeof(uint16_t));
+  }
+  return stageArea(x1, y1, w, h, bitmap, stride, row, true);
+}
+
+// Strips of `rows` rows of an area from row `row` on, the area already even-width: push_w columns from x,
+// padding column included. The odd last strip gets one filler row to keep the height even, below it,
+// or above it on the bottom edge, and with filler_inside whenever there is a strip above.
+// strip() gets each of them, visible on the round panel or not, and stops the loop by returning false.
+template <typename F>
+bool Amoled::forEachStrip(int x, int y, int push_w, int h, int row, int rows, bool filler_inside, F &&strip)
+{
+  for (; row < h; row += rows)
+  {
+    Strip s;
+    s.row = row;
+    s.rows = (h - row < rows) ? h - row : rows;
+    s.last = (row + s.rows >= h);
+    s.y = y + row;
+    s.h = s.rows + (s.rows & 1);
+    s.lead = 0;
+    if (s.h != s.rows && (s.y + s.h > DISPLAY_HEIGHT || (filler_inside && row > 0)))
+    {
+      s.y -= 1;
+      s.lead = 1;
     }
 
-    int y_push = y1 + row;
-    if (rows_this == 1 && y_push == DISPLAY_HEIGHT - 1)
-      y_push -= 1;
+    // Only the columns visible on the round panel are sent, as 2-row windows following the
+    // circle when that saves more than the setup of the extra windows
+    s.w = push_w;
+    s.xa = x;
+    s.xb = x + push_w;
+    s.visible = round_clip(s.y, s.h, s.xa, s.xb);
+    s.step = (s.visible && round_split(s.y, s.h, s.xa, s.xb)) ? 2 : s.h;
+    if (!s.visible)
+      stats.bytes_clipped += (uint32_t)push_w * s.h * sizeof(uint16_t);
+    if (!strip(s))
+      return false;
+  }
+  return true;
+}
 
-    if (esp_lcd_panel_draw_bitmap(panel_handle,
-                                  x1 + x_off, y_push,
-                                  x1 + x_off + push_w, y_push + 2,
-                                  lineBuffer) != ESP_OK)
+// The windows of a visible strip, each one clipped to the round panel: window(wa, wb, wy, wh) gets
+// columns wa to wb - 1 of strip rows wy to wy + wh - 1, and stops the loop by returning false
+template <typename F>
+bool Amoled::forEachWindow(const Strip &s, F &&window)
+{
+  for (int wy = 0; wy < s.h; wy += s.step)
+  {
+    int wa = s.xa, wb = s.xb;
+    if (!round_clip(s.y + wy, s.step, wa, wb))
     {
+      stats.bytes_clipped += (uint32_t)s.w * s.step * sizeof(uint16_t);
+      continue;
+    }
+    stats.bytes_clipped += (uint32_t)(s.w - (wb - wa)) * s.step * sizeof(uint16_t);
+    if (!window(wa, wb, wy, s.step))
       return false;
+  }
+  return true;
+}
+
+// Stage rows `row` to h - 1 of a clipped area (its strips are reserved) and queue them as windows.
+// An area of drawArea is in source order and ends with the flush-done callback; otherwise the
+// pixels are already in panel order (drawBitmap) and are copied as they are, without the shadow diff.
+bool Amoled::stageArea(int x1, int y1, int w, int h, const uint16_t *bitmap, int stride, int row, bool area)
+{
+  // Even width
+  const int push_w = even_width(w);
+  const int rows = strip_rows(push_w, stripSize * sizeof(uint16_t));
+  // An odd area that ends on the right edge has no column to pad on its right: the padding column
+  // goes on its left instead (the area then starts on an odd column, so it is neither clipped nor diffed)
+  const int pad_left = (push_w != w && x1 + push_w > DISPLAY_WIDTH) ? 1 : 0;
+  auto done = [&]()
+  {
+    if (area)
+      signalFlushDone();
+  };
+
+  // With the shadow framebuffer, each row pair is compared with what the panel holds and only
+  // the columns that changed are staged (the diff works on even columns, like the windows)
+  const bool diff = shadowMem && !(x1 & 1) && area;
+
+  auto send_strip = [&](const Strip &s) -> bool
+  {
+    if (!s.visible)
+    {
+      if (s.last)
+        done(); // the source rows are no longer needed
+      return true;
+    }
+
+    // Source row of strip row r (the filler row repeats its neighbour)
+    auto source = [&](int r) -> const uint16_t *
+    {
+      int src_row = s.row + r - s.lead;
+      if (src_row < 0)
+        src_row = 0;
+      if (src_row > h - 1)
+        src_row = h - 1;
+      return bitmap + src_row * stride;
+    };
+
+    // Windows are staged into the strip and pushed one behind, so that the last one can release it.
+    // The strip is only taken from the ring (waiting for the oldest one to leave the bus) once
+    // there is something to send.
+    uint16_t *strip = nullptr;
+    uint16_t *dst = nullptr;
+    const uint16_t *held_buf = nullptr;
+    int held_x = 0, held_y = 0, held_w = 0, held_h = 0;
+    auto emit = [&](int ga, int gb, int gy, int gh) -> bool
+    {
+      const uint32_t t0 = PROFILE_NOW();
+      if (!strip)
+        strip = dst = acquireStrip();
+      const uint32_t t1 = PROFILE_NOW();
+      PROFILE_ADD(wait_us, t1 - t0);
+      const int cols = gb - ga;
+      const int lead_cols = (ga < x1) ? x1 - ga : 0; // the padding column on the left
+      const int src_cols = ((gb < x1 + w) ? gb : x1 + w) - ga - lead_cols; // without the padding column
+      for (int r = gy; r < gy + gh; r++)
+      {
+        const uint16_t *src = source(r);
+        uint16_t *d = dst + (r - gy) * cols + lead_cols;
+        if (area)
+          stage_row(d, src + (ga + lead_cols - x1), src_cols, cols - lead_cols);
+        else
+          stage_row_copy(d, src + (ga + lead_cols - x1), src_cols, cols - lead_cols);
+        if (lead_cols)
+        {
+          d[-1] = d[0];
+          shadow_set(shadow, x1 - 1, s.y + r, area ? src[0] : stage_px(src[0]));
+        }
+        else if (cols != src_cols)
+          shadow_set(shadow, x1 + w, s.y + r, area ? src[w - 1] : stage_px(src[w - 1]));
+        if (r < s.lead || s.row + r - s.lead > h - 1) // the filler row
+          PROFILE_ADD(filler_bytes, cols * sizeof(uint16_t));
+      }
+      PROFILE_ADD(stage_us, PROFILE_NOW() - t1);
+      PROFILE_ADD(pad_bytes, (cols - src_cols) * gh * sizeof(uint16_t));
+      if (!diff)
+        shadow_write(shadow, ga, s.y + gy, cols, gh, dst, cols, 0);
+      stats.bytes_copied += (uint32_t)src_cols * gh * sizeof(uint16_t);
+      if (held_w && !pushToPanel(held_x, held_y, held_buf, held_w, held_h))
+        return false;
+      held_buf = dst;
+      held_x = ga;
+      held_y = s.y + gy;
+      held_w = cols;
+      held_h = gh;
+      dst += cols * gh;
+      return true;
+    };
+
+    auto send_window = [&](int wa, int wb, int wy, int wh) -> bool
+    {
+      if (!diff)
+        return emit(wa, wb, wy, wh);
+
+      // Only the changed columns of each row pair are sent, see shadow_diff_window()
+      const int src_cols = ((wb < x1 + w) ? wb : x1 + w) - wa;
+      const long unchanged = shadow_diff_window(
+          shadow, s.y + wy, wh, wa, wb, src_cols,
+          [&](int r)
+          { return source(wy + r) + (wa - x1); },
+          [&](int ga, int gb, int gy, int gh)
+          { return emit(ga, gb, wy + gy, gh); });
+      if (unchanged < 0)
+        return false;
+      stats.bytes_unchanged += (uint32_t)unchanged * sizeof(uint16_t);
+      return true;
+    };
+
+    bool ok = forEachWindow(s, send_window);
+
+    // The last window releases the strip, and the one of the last strip ends the area
+    const uint8_t flags = TRANSFER_RELEASE_STRIP | (s.last && area ? TRANSFER_END_OF_AREA : 0);
+    if (!ok)
+    {
+      xSemaphoreGive(stripsFree);
+      done();
+    }
+    else if (held_w)
+    {
+      ok = pushToPanel(held_x, held_y, held_buf, held_w, held_h, flags);
+      if (!ok && !s.last)
+        done();
+    }
+    else
+    {
+      if (strip)
+        xSemaphoreGive(stripsFree);
+      if (s.last)
+        done(); // nothing left to send, the source rows are no longer needed
     }
+    if (!ok)
+    {
+      // Whatever this strip was meant to change may not have reached the panel
+      shadow_forget(shadow, x1 - pad_left, s.y, s.w, s.h);
+    }
+    return ok;
+  };
+  return forEachStrip(x1 - pad_left, y1, push_w, h, row, rows, false, send_strip);
+}
+
+bool Amoled::fillArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t color565)
+{
+  TRACE_SCOPE("fillArea");
+  profileBegin();
+  struct ProfileGuard
+  {
+    Amoled *self;
+    ~ProfileGuard() { self->profileEnd(); }
+  } profile_guard = {this};
+
+  if (!panel_handle)
+  {
+    signalFlushDone();
+    return false;
+  }
+
+  // Clipped like drawArea
+  int xs = (int)x1, ys = (int)y1, xe = (int)x2 + 1, ye = (int)y2 + 1;
+  if (xs < 0)
+    xs = 0;
+  if (ys < 0)
+    ys = 0;
+  if (xe > DISPLAY_WIDTH)
+    xe = DISPLAY_WIDTH;
+  if (ye > DISPLAY_HEIGHT)
+    ye = DISPLAY_HEIGHT;
+  const int w = xe - xs, h = ye - ys;
+  if (w <= 0 || h <= 0)
+  {
+    signalFlushDone();
+    return true;
+  }
+#if TE_SYNC >= 2
+  waitScanLine(ys - 1, ys + h + 1); // filler row included
+#endif
+  if (!reserveStrips() || stripSize < even_width(w) * 2)
+  {
+    signalFlushDone();
+    return false;
+  }
+  stats.flushes++;
+  stats.fill_flushes++;
+  streamBottom = ys + h + ((h & 1) && ys + h < DISPLAY_HEIGHT ? 1 : 0);
+  return fillWindows(xs, ys, w, h, color565, true);
+}
+
+// Send a clipped area of one color (its strips are reserved) as the windows of stageArea, all from the
+// same strip: it holds the color everywhere, so each window reads it from its start. An area of fillArea
+// ends with the flush-done callback; a rect of fillRect keeps the filler row of its last strip inside it
+// when there is a strip above.
+bool Amoled::fillWindows(int xs, int ys, int w, int h, uint16_t color565, bool area)
+{
+  const int push_w = even_width(w);
+  const int rows = strip_rows(push_w, stripSize * sizeof(uint16_t));
+  const int xa0 = xs - ((push_w != w && xs + push_w > DISPLAY_WIDTH) ? 1 : 0); // padding column on the left
+  uint16_t *strip = nullptr;
+  int held_x = 0, held_y = 0, held_w = 0, held_h = 0;
+  auto send_strip = [&](const Strip &s) -> bool
+  {
+    if (!s.visible)
+      return true;
+    shadow_write(shadow, xa0, s.y, push_w, s.h, NULL, 0, color565);
+    auto send_window = [&](int wa, int wb, int wy, int wh) -> bool
+    {
+      if (!strip)
+      {
+        const uint32_t t0 = PROFILE_NOW();
+        strip = acquireSolidStrip(toBE565(color565), push_w * (h + (h & 1) < rows ? h + (h & 1) : rows));
+        PROFILE_ADD(wait_us, PROFILE_NOW() - t0);
+      }
+      // Pushed one behind, so that the last window can release the strip and end the area
+      if (held_w && !pushToPanel(held_x, held_y, strip, held_w, held_h))
+        return false;
+      held_x = wa;
+      held_y = s.y + wy;
+      held_w = wb - wa;
+      held_h = wh;
+      return true;
+    };
+    return forEachWindow(s, send_window);
+  };
+
+  if (!forEachStrip(xa0, ys, push_w, h, 0, rows, !area, send_strip))
+  {
+    xSemaphoreGive(stripsFree);
+    shadow_forget(shadow, xa0, ys, push_w, h);
+    if (area)
+      signalFlushDone();
+    return false;
+  }
+  if (!held_w)
+  {
+    if (strip)
+      xSemaphoreGive(stripsFree);
+    if (area)
+      signalFlushDone(); // nothing visible
+    return true;
+  }
+  if (!pushToPanel(held_x, held_y, strip, held_w, held_h, TRANSFER_RELEASE_STRIP | (area ? TRANSFER_END_OF_AREA : 0)))
+  {
+    shadow_forget(shadow, xa0, ys, push_w, h);
+    return false;
   }
   return true;
 }
 
-bool Amoled::reserveLineBuffer()
+bool Amoled::reserveStrips()
 {
-  if (lineBuffer)
+  if (stripsFree)
     return true;
 
-  int push_w_max = (DISPLAY_WIDTH & 1) ? DISPLAY_WIDTH + 1 : DISPLAY_WIDTH;
-  lineBuffer = (uint16_t *)heap_caps_malloc(push_w_max * 2 * sizeof(uint16_t),
-                                            MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
-  if (!lineBuffer)
+  // STRIP_SIZE bytes per strip, but never less than 2 full rows
+  int push_w_max = even_width(DISPLAY_WIDTH);
+  int elements = STRIP_SIZE / sizeof(uint16_t);
+  if (elements < push_w_max * 2)
+    elements = push_w_max * 2;
+  for (int i = 0; i < STRIP_BUFFERS; i++)
+  {
+    if (!strips[i])
+      strips[i] = (uint16_t *)heap_caps_malloc(elements * sizeof(uint16_t),
+                                               MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    if (!strips[i])
+      return false;
+  }
+  stripsFree = xSemaphoreCreateCounting(STRIP_BUFFERS, STRIP_BUFFERS);
+  if (!stripsFree)
     return false;
 
-  lineBufferSize = push_w_max * 2;
+  stripSize = elements;
   return true;
 }
 
-bool Amoled::pushToPanel(int x, int y, const uint16_t *buf, int w, int h)
+bool Amoled::reserveShadow()
+{
+  if (shadowMem || !shadow_bytes())
+    return shadowMem != nullptr;
+  shadowMem = heap_caps_malloc(shadow_bytes(), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  shadow_init(shadow, shadowMem);
+  return shadowMem != nullptr;
+}
+
+uint16_t *Amoled::acquireStrip()
+{
+  // Transfers complete in queue order, so a free count means the oldest strip is free
+  xSemaphoreTake(stripsFree, portMAX_DELAY);
+  uint16_t *strip = strips[nextStrip];
+  stripFilled[nextStrip] = 0; // staged over
+  nextStrip = (nextStrip + 1) % STRIP_BUFFERS;
+  return strip;
+}
+
+// A strip whose first `count` pixels are `be` (panel order). Back-to-back solid areas (the bands of a
+// plain background) take strips that already hold their color, and are sent without writing a pixel.
+uint16_t *Amoled::acquireSolidStrip(uint16_t be, int count)
+{
+  const int i = nextStrip;
+  const int filled = (stripColor[i] == be) ? stripFilled[i] : 0;
+  uint16_t *strip = acquireStrip();
+  for (int k = filled; k < count; ++k)
+    strip[k] = be;
+  stripColor[i] = be;
+  stripFilled[i] = (filled > count) ? filled : count;
+  return strip;
+}
+
+void Amoled::signalFlushDone()
+{
+#if FLUSH_PROFILE
+  profileFlushDone((areaSeq - 1) % PENDING_MAX);
+#endif
+  if (flushDoneCb)
+    flushDoneCb(flushDoneCtx);
+}
+
+void Amoled::waitTransfers()
+{
+  while (pendingHead != pendingTail)
+    vTaskDelay(1);
+}
+
+// Transfer-done ISR: retire the oldest transfer in flight
+bool IRAM_ATTR Amoled::onColorDone(esp_lcd_panel_handle_t panel, void *user_ctx)
+{
+  (void)panel;
+  Amoled *self = (Amoled *)user_ctx;
+  BaseType_t woken = pdFALSE;
+  if (self->pendingHead == self->pendingTail)
+    return false;
+  uint8_t flags = self->pending[self->pendingHead % PENDING_MAX];
+#if FLUSH_PROFILE
+  const uint8_t area = self->pendingArea[self->pendingHead % PENDING_MAX];
+#endif
+  self->pendingHead = self->pendingHead + 1;
+  if (flags & TRANSFER_RELEASE_STRIP)
+    xSemaphoreGiveFromISR(self->stripsFree, &woken);
+#if FLUSH_PROFILE
+  if (flags & TRANSFER_END_OF_AREA)
+    self->profileFlushDone(area);
+#endif
+  if ((flags & TRANSFER_END_OF_AREA) && self->flushDoneCb)
+    self->flushDoneCb(self->flushDoneCtx);
+  return woken == pdTRUE;
+}
+
+#if TE_SYNC
+bool Amoled::beginTearingEffect()
 {
-  const int x1 = (controller_id == SH8601_ID) ? x : x + 0x06;
-  const int x2 = (controller_id == SH8601_ID) ? x + w : x + w + 0x06;
-  const int y1 = y;
-  const int y2 = y + h; // end-exclusive
-  return esp_lcd_panel_draw_bitmap(panel_handle, x1, y1, x2, y2, buf) == ESP_OK;
+#if PIN_NUM_LCD_TE >= 0
+  if (teSignal)
+    return true;
+  teSignal = xSemaphoreCreateBinary();
+  if (!teSignal)
+    return false;
+  const gpio_config_t te_config = {
+      .pin_bit_mask = 1ULL << PIN_NUM_LCD_TE,
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_POSEDGE,
+  };
+  // The ISR service may already be installed by the application (attachInterrupt)
+  const esp_err_t err = gpio_install_isr_service(0);
+  if ((err == ESP_OK || err == ESP_ERR_INVALID_STATE) && gpio_config(&te_config) == ESP_OK &&
+      gpio_isr_handler_add((gpio_num_t)PIN_NUM_LCD_TE, onTearingEffect, this) == ESP_OK)
+    return true;
+  vSemaphoreDelete(teSignal);
+  teSignal = NULL;
+#endif
+  return false;
+}
+
+// TE ISR: the panel scan has reached TE_SCANLINE
+void IRAM_ATTR Amoled::onTearingEffect(void *arg)
+{
+  Amoled *self = (Amoled *)arg;
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  const uint32_t period = now - self->teTime;
+  const uint32_t known = self->tePeriod;
+  // Pulses refine the period, missed or spurious ones (far from it) are left out
+  if (self->teTime && (known ? (period > known - known / 4 && period < known + known / 4) : (period > 5000 && period < 50000)))
+    self->tePeriod = known ? (known * 7 + period) / 8 : period;
+  self->teTime = now;
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(self->teSignal, &woken);
+  if (woken == pdTRUE)
+    portYIELD_FROM_ISR();
+}
+
+bool Amoled::waitTearingEffect(uint32_t timeout_ms)
+{
+  if (!teSignal)
+    return false;
+  // A pulse that came while the caller was busy is only good if the scan has not gone far since
+  if (xSemaphoreTake(teSignal, 0) == pdTRUE && (uint32_t)esp_timer_get_time() - teTime < tePeriod / 4)
+    return true;
+  return xSemaphoreTake(teSignal, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+uint32_t Amoled::refreshPeriod()
+{
+  return tePeriod;
+}
+
+int Amoled::scanLine()
+{
+  if (!tePeriod)
+    return -1;
+  return te_scan_line((uint32_t)esp_timer_get_time() - teTime, tePeriod);
+}
+
+// Hold an area back while the scan line is on its rows (or about to be, see amoled_te.h)
+void Amoled::waitScanLine(int top, int bottom)
+{
+  const int line = scanLine();
+  if (line < 0)
+    return;
+  const uint32_t us = te_wait_us(line, top, bottom, tePeriod);
+  if (us >= 1000)
+    vTaskDelay(pdMS_TO_TICKS(us / 1000));
+  if (us % 1000)
+    esp_rom_delay_us(us % 1000);
+}
+#endif
+
+void Amoled::setFlushDoneCallback(AmoledFlushDoneCb cb, void *user_ctx)
+{
+  flushDoneCb = cb;
+  flushDoneCtx = user_ctx;
+}
+
+// Queue one window of pixels; the flags are honoured when its color data has been sent,
+// or right away if the transfer could not be queued
+bool Amoled::pushToPanel(int x, int y, const uint16_t *buf, int w, int h, uint8_t flags)
+{
+  // A sleeping panel takes no pixels: wake it first (SLEEP_OUT_MS)
+  if (powerSent & AMOLED_POWER_SLEEP)
+    setPowerMode(power & ~AMOLED_POWER_SLEEP);
+  // Record the transfer before queueing it, the ISR may fire before write_color returns
+  const uint32_t t0 = PROFILE_NOW();
+  while (pendingTail - pendingHead >= PENDING_MAX)
+    vTaskDelay(1);
+  const uint32_t tail = pendingTail;
+  pending[tail % PENDING_MAX] = flags;
+#if FLUSH_PROFILE
+  pendingArea[tail % PENDING_MAX] = (areaSeq - 1) % PENDING_MAX;
+#endif
+  pendingTail = tail + 1;
+
+  // A transfer that continues the window of the previous one only sends its pixels (RAMWRC).
+  // Otherwise the new window reaches down to streamBottom, so that the next strips can continue it:
+  // setting a window waits for the transfers in flight, continuing it does not.
+  const bool cont = STREAM_WRITES && stream_continues(stream, x, y, w, h);
+  esp_err_t err = ESP_OK;
+  if (!cont)
+  {
+    const int end_y = STREAM_WRITES ? stream_window_end(y, h, streamBottom) : y + h;
+    stream.w = 0;
+    err = esp_amoled_panel_set_window(panel_handle, x + x_offset, y, x + w + x_offset, end_y);
+    if (err == ESP_OK)
+    {
+      stream.x = x;
+      stream.w = w;
+      stream.end_y = end_y;
+    }
+  }
+  if (err == ESP_OK)
+    err = esp_amoled_panel_write_color(panel_handle, buf, w * h * sizeof(uint16_t), cont);
+  PROFILE_ADD(wait_us, PROFILE_NOW() - t0); // the window waits for the transfers in flight, the pixels for room in the queue
+  if (err != ESP_OK)
+  {
+    stream.w = 0;
+    pendingTail = tail; // nothing was queued, so no completion will retire it
+    if (flags & TRANSFER_RELEASE_STRIP)
+      xSemaphoreGive(stripsFree);
+    if (flags & TRANSFER_END_OF_AREA)
+      signalFlushDone();
+    return false;
+  }
+  stream.next_y = y + h;
+  stats.bytes_sent += (uint32_t)w * h * sizeof(uint16_t);
+  stats.transfers++;
+  if (!cont)
+    stats.windows++;
+  PROFILE_ADD(bytes_sent, w * h * sizeof(uint16_t));
+  PROFILE_ADD(transfers, 1);
+  PROFILE_ADD(windows, cont ? 0 : 1);
+  return true;
+}
+
+const AmoledFlushStats &Amoled::flushStats()
+{
+  return stats;
+}
+
+void Amoled::resetFlushStats()
+{
+  stats = AmoledFlushStats();
+}
+
+#if FLUSH_PROFILE
+// Start the profile of a drawArea call, in the frame that is open (or a new one)
+void Amoled::profileBegin()
+{
+  collectFrames();
+  // The record of the call must be free, and so must the slot of its frame: waiting for the
+  // transfers in flight only happens when the panel is two frames behind
+  FrameSlot *slot = &frameSlots[frameSeq & 1];
+  if (areaSeq - areasCollected >= PENDING_MAX || (slot->open && slot->ended))
+  {
+    waitTransfers();
+    collectFrames();
+  }
+  const uint32_t now = PROFILE_NOW();
+  if (!slot->open)
+  {
+    *slot = FrameSlot();
+    slot->profile.period_us = frameSeq ? now - lastFrameStart : 0;
+    slot->start_us = slot->last_done_us = now;
+    slot->open = true;
+    lastFrameStart = now;
+  }
+  AreaRecord &area = areas[areaSeq % PENDING_MAX];
+  area.start_us = now;
+  area.latency_us = 0;
+  area.done = false;
+  area.slot = frameSeq & 1;
+  areaSeq++;
+  slot->in_flight++;
+  flushProf = AmoledFlushProfile();
+  flushStart = now;
+}
+
+void Amoled::profileEnd()
+{
+  flushProf.call_us = PROFILE_NOW() - flushStart;
+  AmoledFrameProfile &frame = frameSlots[areas[(areaSeq - 1) % PENDING_MAX].slot].profile;
+  frame.flushes++;
+  frame.sum.transfers += flushProf.transfers;
+  frame.sum.windows += flushProf.windows;
+  frame.sum.bytes_sent += flushProf.bytes_sent;
+  frame.sum.pad_bytes += flushProf.pad_bytes;
+  frame.sum.filler_bytes += flushProf.filler_bytes;
+  frame.sum.stage_us += flushProf.stage_us;
+  frame.sum.wait_us += flushProf.wait_us;
+  frame.sum.call_us += flushProf.call_us;
+  lastFlush = flushProf;
+  collectFrames();
+}
+
+// From the transfer-done ISR, or from drawArea when nothing was left to send
+void IRAM_ATTR Amoled::profileFlushDone(uint8_t area)
+{
+  areas[area].latency_us = PROFILE_NOW() - areas[area].start_us;
+  areas[area].done = true;
+}
+
+// Add the drawArea calls that are done to their frame, in call order, and publish the frames
+// whose calls are all done
+void Amoled::collectFrames()
+{
+  while (areasCollected != areaSeq)
+  {
+    const AreaRecord &area = areas[areasCollected % PENDING_MAX];
+    if (!area.done)
+      break;
+    const uint32_t latency = area.latency_us;
+    FrameSlot &slot = frameSlots[area.slot];
+    slot.profile.sum.latency_us += latency;
+    if (latency > slot.profile.latency_max_us)
+      slot.profile.latency_max_us = latency;
+    if ((int32_t)(area.start_us + latency - slot.last_done_us) > 0)
+      slot.last_done_us = area.start_us + latency;
+    slot.in_flight--;
+    areasCollected++;
+    if (areasCollected == areaSeq)
+      lastFlush.latency_us = latency;
+  }
+  // The older frame is in the slot of the open one when it has ended already
+  for (int i = 0; i < 2; i++)
+  {
+    FrameSlot &slot = frameSlots[(frameSeq + i) & 1];
+    if (!slot.open || !slot.ended || slot.in_flight)
+      continue;
+    slot.profile.frame_us = slot.last_done_us - slot.start_us;
+    lastFrame = slot.profile;
+    framesDone++;
+    slot.open = slot.ended = false;
+  }
+}
+
+void Amoled::endFrame()
+{
+  FrameSlot &slot = frameSlots[frameSeq & 1];
+  if (!slot.open)
+    return;
+  slot.ended = true;
+  frameSeq++;
+  collectFrames();
+}
+
+const AmoledFlushProfile &Amoled::flushProfile()
+{
+  collectFrames();
+  return lastFlush;
+}
+
+const AmoledFrameProfile &Amoled::frameProfile()
+{
+  collectFrames();
+  return lastFrame;
+}
+
+uint32_t Amoled::frameCount()
+{
+  collectFrames();
+  return framesDone;
+}
+#endif
+
+bool Amoled::sendBrightness(uint8_t value)
+{
+  stream.w = 0; // any command ends a memory write
+  if (esp_amoled_panel_set_brightness(panel_handle, value) != ESP_OK)
+    return false;
+  level = value;
+  levelSent = (uint32_t)esp_timer_get_time();
+  return true;
+}
+
+bool Amoled::setBrightness(uint8_t value)
+{
+  if (!panel_handle)
+    return false;
+  fadeActive = false;
+  return sendBrightness(value);
+}
+
+void Amoled::fadeBrightness(uint8_t value, uint32_t duration_ms, AmoledFadeCurve curve)
+{
+  fadeFrom = level;
+  fadeTo = value;
+  fadeCurve = curve;
+  fadeStart = (uint32_t)esp_timer_get_time();
+  fadeUs = duration_ms * 1000;
+  fadeActive = true;
+}
+
+// A fade is a series of 2-byte commands, at most one every BRIGHTNESS_STEP_MS. A command waits
+// for the pixels in flight and holds the next ones behind it, so a step is only sent when the bus is idle.
+bool Amoled::updateBrightness()
+{
+  if (!fadeActive || !panel_handle)
+    return false;
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  if (now - levelSent < BRIGHTNESS_STEP_MS * 1000 || pendingHead != pendingTail)
+    return true;
+  const uint32_t elapsed = now - fadeStart;
+  const uint8_t value = fade_level(fadeFrom, fadeTo, elapsed, fadeUs, fadeCurve);
+  if (value != level && !sendBrightness(value))
+    return true; // tried again next time
+  if (elapsed >= fadeUs)
+    fadeActive = false;
+  return fadeActive;
+}
+
+uint8_t Amoled::brightness()
+{
+  return level;
+}
+
+// The panel needs SLEEP_OUT_MS between two sleep in/out commands
+void Amoled::waitSleepChange()
+{
+  const int64_t since = esp_timer_get_time() - sleepChanged;
+  if (since < SLEEP_OUT_MS * 1000)
+    vTaskDelay(pdMS_TO_TICKS((SLEEP_OUT_MS * 1000 - since + 999) / 1000) + 1);
+}
+
+// Adds the time since the last count to the modes the panel is in
+void Amoled::countPowerTime()
+{
+  const int64_t now = esp_timer_get_time();
+  const uint32_t ms = (uint32_t)((now - powerSince) / 1000);
+  powerSince += (int64_t)ms * 1000; // the remainder goes to the next count
+  if (powerSent & AMOLED_POWER_SLEEP)
+    powerStat.sleep_ms += ms;
+  else if (!(powerSent & (AMOLED_POWER_IDLE | AMOLED_POWER_PARTIAL)))
+    powerStat.normal_ms += ms;
+  if (!(powerSent & AMOLED_POWER_SLEEP) && (powerSent & AMOLED_POWER_IDLE))
+    powerStat.idle_ms += ms;
+  if (!(powerSent & AMOLED_POWER_SLEEP) && (powerSent & AMOLED_POWER_PARTIAL))
+    powerStat.partial_ms += ms;
+}
+
+// Brings the panel from powerSent to power. Idle and partial modes are only changed while the panel is
+// awake: before it goes to sleep, or once it has woken up.
+bool Amoled::sendPowerMode()
+{
+  const int64_t start = esp_timer_get_time();
+  stream.w = 0; // any command ends a memory write
+  if ((powerSent & AMOLED_POWER_SLEEP) && !(power & AMOLED_POWER_SLEEP))
+  {
+    waitSleepChange();
+    if (esp_amoled_panel_sleep(panel_handle, false) != ESP_OK)
+      return false;
+    sleepChanged = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(SLEEP_OUT_MS)); // no pixels before
+    if (esp_lcd_panel_disp_on_off(panel_handle, true) != ESP_OK)
+      return false;
+    countPowerTime();
+    powerSent &= ~AMOLED_POWER_SLEEP;
+    const uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    powerStat.wakes++;
+    powerStat.wake_us = us;
+    if (us > powerStat.wake_max_us)
+      powerStat.wake_max_us = us;
+  }
+  if (powerSent & AMOLED_POWER_SLEEP)
+    return true; // staying asleep, the other changes wait for the wake
+  if ((power ^ powerSent) & AMOLED_POWER_IDLE)
+  {
+    if (esp_amoled_panel_set_idle(panel_handle, power & AMOLED_POWER_IDLE) != ESP_OK)
+      return false;
+    countPowerTime();
+    powerSent ^= AMOLED_POWER_IDLE;
+  }
+  if (((power ^ powerSent) & AMOLED_POWER_PARTIAL) || (partialStale && (power & AMOLED_POWER_PARTIAL)))
+  {
+    const bool partial = power & AMOLED_POWER_PARTIAL;
+    if (esp_amoled_panel_set_partial(panel_handle, partial ? partialTop : 0, partial ? partialBottom : 0) != ESP_OK)
+      return false;
+    countPowerTime();
+    powerSent = (powerSent & ~AMOLED_POWER_PARTIAL) | (power & AMOLED_POWER_PARTIAL);
+    partialStale = false;
+  }
+  if (power & AMOLED_POWER_SLEEP)
+  {
+    waitSleepChange();
+    if (esp_lcd_panel_disp_on_off(panel_handle, false) != ESP_OK || esp_amoled_panel_sleep(panel_handle, true) != ESP_OK)
+      return false;
+    sleepChanged = esp_timer_get_time();
+    countPowerTime();
+    powerSent |= AMOLED_POWER_SLEEP;
+  }
+  return true;
+}
+
+bool Amoled::setPowerMode(uint8_t mode)
+{
+  if (!panel_handle)
+    return false;
+  mode &= AMOLED_POWER_IDLE | AMOLED_POWER_PARTIAL | AMOLED_POWER_SLEEP;
+  if (mode == power && mode == powerSent && !(partialStale && (mode & AMOLED_POWER_PARTIAL)))
+    return true;
+  if (mode != power)
+    powerStat.changes++;
+  power = mode;
+  return sendPowerMode();
+}
+
+uint8_t Amoled::powerMode()
+{
+  return power;
+}
+
+bool Amoled::setPartialArea(int top, int bottom)
+{
+  if (top < 0)
+    top = 0;
+  if (bottom > DISPLAY_HEIGHT)
+    bottom = DISPLAY_HEIGHT;
+  if (top >= bottom)
+    return false;
+  if (top == partialTop && bottom == partialBottom)
+    return true;
+  partialTop = top;
+  partialBottom = bottom;
+  partialStale = true; // sent when partial mode is on and the panel awake
+  if (!panel_handle || !(power & AMOLED_POWER_PARTIAL) || (powerSent & AMOLED_POWER_SLEEP))
+    return true;
+  return sendPowerMode();
+}
+
+void Amoled::setPowerPolicy(AmoledPowerPolicy policy, void *user_ctx)
+{
+  powerPolicy = policy;
+  powerPolicyCtx = user_ctx;
+}
+
+// The policy is only asked here, from the task that flushes, so its commands never come between the
+// transfers of an area
+uint8_t Amoled::updatePower(uint32_t inactive_ms)
+{
+  if (powerPolicy)
+    setPowerMode(powerPolicy(inactive_ms, powerPolicyCtx));
+  return power;
+}
+
+const AmoledPowerStats &Amoled::powerStats()
+{
+  countPowerTime();
+  return powerStat;
+}
+
+void Amoled::resetPowerStats()
+{
+  countPowerTime();
+  powerStat = AmoledPowerStats();
 }
 
 bool Amoled::invertColor(bool invertColor)
 {
+  stream.w = 0; // any command ends a memory write
   return esp_lcd_panel_invert_color(panel_handle, invertColor) == ESP_OK;
 }
 
@@ -229,6 +1195,9 @@ uint8_t Amoled::ID()
 
 char *Amoled::name()
 {
+#if AMOLED_CONTROLLER
+  return (char *)AmoledController<AMOLED_CONTROLLER>::name;
+#else
   switch (ID())
   {
   case SH8601_ID:
@@ -238,6 +1207,7 @@ char *Amoled::name()
   default:
     return "Unknown";
   }
+#endif
 }
 
 bool Amoled::fillScreen(uint16_t color565)
@@ -247,7 +1217,7 @@ bool Amoled::fillScreen(uint16_t color565)
 
 bool Amoled::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color565)
 {
-  if (!panel_handle || w <= 0 || h <= 0)
+  if (!panel_handle || !stripsFree || w <= 0 || h <= 0)
     return false;
 
   // Clip
@@ -264,36 +1234,7 @@ bool Amoled::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color
   if (cw <= 0 || ch <= 0)
     return true;
 
-  // Even width for the panel, and always push 2 rows
-  const bool pad_col = (cw & 1);
-  const int push_w = cw + (pad_col ? 1 : 0);
-  const int need = push_w * 2; // elements for 2 rows
-
-  const uint16_t be = toBE565(color565);
-
-  // Build 2 rows in the reusable buffer
-  for (int col = 0; col < cw; ++col)
-  {
-    lineBuffer[col] = be;
-    lineBuffer[push_w + col] = be;
-  }
-  if (pad_col)
-  { // duplicate last column
-    lineBuffer[push_w - 1] = be;
-    lineBuffer[push_w + push_w - 1] = be;
-  }
-
-  // Push in 2-row slices (height=2 is required by this panel quirk)
-  for (int row = 0; row < ch; row += 2)
-  {
-    int y_push = ys + row;
-    if ((ch & 1) && row == ch - 1)
-    { // last single line -> shift up to keep height=2 on-screen
-      if (y_push > ys)
-        y_push -= 1;
-    }
-    if (!pushToPanel(xs, y_push, lineBuffer, push_w, 2))
-      return false;
-  }
-  return true;
+  // Sent like an area of fillArea, without the flush-done callback
+  streamBottom = ye;
+  return fillWindows(xs, ys, cw, ch, color565, false);
 }
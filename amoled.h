@@ -6,11 +6,16 @@
 #include "Arduino.h"
 #include "low_level_amoled.h"
 #include "board_config.h"
+#include "amoled_flush.h"
+#include "amoled_controller.h"
+#include "amoled_shadow.h"
 #include "esp_lcd_panel_interface.h"
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_panel_vendor.h"
 #include "esp_lcd_panel_ops.h"
 #include "esp_lcd_panel_commands.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 // Human-readable RGB565 colors (programmer shortcuts)
 enum Color565 : uint16_t
@@ -42,15 +47,206 @@ enum Color565 : uint16_t
     AMOLED_COLOR_SKYBLUE = 0x867D,
 };
 
+// Pixel traffic counters of the flush path
+struct AmoledFlushStats
+{
+    uint32_t flushes = 0;           // drawArea and fillArea calls
+    uint32_t zero_copy_flushes = 0; // drawArea calls sent straight from the caller's buffer
+    uint32_t fill_flushes = 0;      // fillArea calls, sent from a strip of their color
+    uint32_t bytes_copied = 0;      // bytes staged into the DMA strip buffer
+    uint32_t bytes_sent = 0;        // pixel bytes sent to the panel (padding included)
+    uint32_t bytes_clipped = 0;     // pixel bytes left out because they are outside the round panel
+    uint32_t bytes_unchanged = 0;   // pixel bytes left out because the panel already holds them (shadow framebuffer)
+    uint32_t transfers = 0;         // panel transfers sent
+    uint32_t windows = 0;           // panel windows opened, each one costs a CASET/RASET/RAMWR (others continue with RAMWRC)
+};
+
+// Cost of one drawArea call, when FLUSH_PROFILE is enabled
+struct AmoledFlushProfile
+{
+    uint32_t transfers = 0;    // panel transfers queued
+    uint32_t windows = 0;      // transfers that opened a window (CASET/RASET)
+    uint32_t bytes_sent = 0;   // pixel bytes sent, padding included
+    uint32_t pad_bytes = 0;    // padding column added to odd widths (even_width)
+    uint32_t filler_bytes = 0; // rows repeated to keep the strip heights even
+    uint32_t stage_us = 0;     // copying and byte-swapping into the staging strips
+    uint32_t wait_us = 0;      // waiting for a free strip or for the SPI queue
+    uint32_t call_us = 0;      // the whole drawArea call
+    uint32_t latency_us = 0;   // from the start of drawArea to the flush-done callback
+};
+
+// Cost of one frame: the drawArea calls between two endFrame() calls
+struct AmoledFrameProfile
+{
+    uint32_t flushes = 0;
+    AmoledFlushProfile sum;      // of all the flushes (latency_us too)
+    uint32_t latency_max_us = 0; // slowest flush
+    uint32_t frame_us = 0;       // from the first drawArea of the frame to its last flush done
+    uint32_t period_us = 0;      // from the start of the previous frame to the start of this one
+};
+
+// Shape of a brightness fade, Amoled::fadeBrightness
+enum AmoledFadeCurve : uint8_t
+{
+    AMOLED_FADE_LINEAR,
+    AMOLED_FADE_EASE_IN,     // starts slowly
+    AMOLED_FADE_EASE_OUT,    // ends slowly
+    AMOLED_FADE_EASE_IN_OUT, // both (smoothstep)
+};
+
+// Power features of the panel, combined in the mode of Amoled::setPowerMode
+enum AmoledPowerMode : uint8_t
+{
+    AMOLED_POWER_NORMAL = 0x00,
+    AMOLED_POWER_IDLE = 0x01,    // 8 colors (0x39)
+    AMOLED_POWER_PARTIAL = 0x02, // only the rows of setPartialArea are lit (0x30, 0x12)
+    AMOLED_POWER_SLEEP = 0x04,   // display off and sleep in (0x10), the panel keeps its memory
+};
+
+// Time spent in each power mode, and what waking up costs
+struct AmoledPowerStats
+{
+    uint32_t normal_ms = 0;   // awake, no power feature on
+    uint32_t idle_ms = 0;     // awake in idle mode, with partial mode or not
+    uint32_t partial_ms = 0;  // awake in partial mode, with idle mode or not
+    uint32_t sleep_ms = 0;
+    uint32_t changes = 0;     // mode changes sent to the panel
+    uint32_t wakes = 0;       // sleep outs
+    uint32_t wake_us = 0;     // last wake, from the call to the panel taking pixels again
+    uint32_t wake_max_us = 0;
+};
+
+// Power mode the panel should be in after `inactive_ms` without user input, Amoled::updatePower
+typedef uint8_t (*AmoledPowerPolicy)(uint32_t inactive_ms, void *user_ctx);
+
+// Called from the SPI ISR once every pixel of a drawArea or fillArea call has been sent to the panel
+typedef void (*AmoledFlushDoneCb)(void *user_ctx);
+
 class Amoled
 {
 private:
+    // Flags of a queued panel transfer, handled when its color data has been sent
+    enum : uint8_t
+    {
+        TRANSFER_RELEASE_STRIP = 0x01, // the transfer was the last user of its staging strip
+        TRANSFER_END_OF_AREA = 0x02,   // the transfer was the last one of a drawArea call
+    };
+    static const int PENDING_MAX = 16; // power of 2, above the number of transfers in flight
+
     uint8_t controller_id = 0x00;
+#if AMOLED_CONTROLLER
+    static constexpr int x_offset = AmoledController<AMOLED_CONTROLLER>::x_offset;
+#else
+    int x_offset = 0; // of the controller read by begin()
+#endif
     esp_lcd_panel_handle_t panel_handle = NULL;
-    uint16_t *lineBuffer; // 2 rows
-    int lineBufferSize = 0;
-    inline bool pushToPanel(int x, int y, const uint16_t *buf, int w, int h);
-    bool reserveLineBuffer();
+    uint16_t *strips[STRIP_BUFFERS] = {}; // ring of DMA staging strips, STRIP_SIZE bytes each
+    int stripSize = 0;                    // elements per strip
+    int nextStrip = 0;
+    uint16_t stripColor[STRIP_BUFFERS] = {}; // solid color (panel order) a strip was filled with by fillArea or fillRect
+    int stripFilled[STRIP_BUFFERS] = {};     // pixels of that color at the start of the strip, 0 once staged over
+    SemaphoreHandle_t stripsFree = NULL;  // strips not referenced by a transfer in flight
+    uint8_t pending[PENDING_MAX];         // flags of the transfers in flight, in queue order
+    volatile uint32_t pendingHead = 0;    // advanced by the transfer-done ISR
+    volatile uint32_t pendingTail = 0;    // advanced by pushToPanel
+    StreamWindow stream = {};             // window left open by the last transfer
+    int streamBottom = 0;                 // during drawArea, the last row (exclusive) later strips may continue to
+    AmoledFlushDoneCb flushDoneCb = nullptr;
+    void *flushDoneCtx = nullptr;
+    AmoledShadow shadow = {};             // what the panel holds, when SHADOW_FRAMEBUFFER is enabled
+    void *shadowMem = nullptr;
+    AmoledFlushStats stats;
+    uint8_t level = 0xFF;                 // brightness last sent, the init tables end with 0xFF
+    uint8_t fadeFrom = 0xFF, fadeTo = 0xFF;
+    AmoledFadeCurve fadeCurve = AMOLED_FADE_LINEAR;
+    bool fadeActive = false;
+    uint32_t fadeStart = 0, fadeUs = 0;   // esp_timer time
+    uint32_t levelSent = 0;               // when the last brightness command was sent
+    bool sendBrightness(uint8_t value);
+    uint8_t power = AMOLED_POWER_NORMAL;  // mode asked for
+    uint8_t powerSent = AMOLED_POWER_NORMAL; // mode the panel is in
+    int partialTop = 0, partialBottom = DISPLAY_HEIGHT;
+    bool partialStale = false;            // the partial area changed since it was sent
+    AmoledPowerPolicy powerPolicy = nullptr;
+    void *powerPolicyCtx = nullptr;
+    AmoledPowerStats powerStat;
+    int64_t powerSince = 0;               // esp_timer time powerStat is counted up to
+    int64_t sleepChanged = 0;             // when the last sleep in/out was sent
+    bool sendPowerMode();
+    void waitSleepChange();
+    void countPowerTime();
+#if FLUSH_PROFILE
+    // Completion of a drawArea call, written by the ISR and added to its frame by collectFrames()
+    struct AreaRecord
+    {
+        uint32_t start_us;
+        volatile uint32_t latency_us;
+        volatile bool done;
+        uint8_t slot;
+    };
+    // Frames are profiled in two slots (by parity), so that the last flushes of a frame can
+    // complete while the next one starts
+    struct FrameSlot
+    {
+        AmoledFrameProfile profile;
+        uint32_t start_us, last_done_us;
+        uint32_t in_flight; // drawArea calls not collected yet
+        bool open, ended;
+    };
+    AreaRecord areas[PENDING_MAX] = {};
+    uint8_t pendingArea[PENDING_MAX];  // record of the drawArea call ended by a transfer in flight
+    uint32_t areaSeq = 0;              // drawArea calls started
+    uint32_t areasCollected = 0;       // drawArea calls added to their frame
+    FrameSlot frameSlots[2] = {};
+    uint32_t frameSeq = 0;             // frame the next drawArea calls belong to
+    uint32_t lastFrameStart = 0;
+    uint32_t framesDone = 0;
+    AmoledFrameProfile lastFrame;      // last frame whose flushes are all done
+    AmoledFlushProfile flushProf;      // drawArea call in progress
+    AmoledFlushProfile lastFlush;
+    uint32_t flushStart = 0;
+    void profileBegin();
+    void profileEnd();
+    void profileFlushDone(uint8_t area);
+    void collectFrames();
+#else
+    void profileBegin() {}
+    void profileEnd() {}
+#endif
+#if TE_SYNC
+    SemaphoreHandle_t teSignal = NULL; // given by every TE pulse, NULL when the TE line is not followed
+    volatile uint32_t teTime = 0;      // of the last TE pulse (us)
+    volatile uint32_t tePeriod = 0;    // panel refresh period measured on the pulses (us), 0 until known
+    bool beginTearingEffect();
+    void waitScanLine(int top, int bottom);
+    static void onTearingEffect(void *arg);
+#endif
+    bool pushToPanel(int x, int y, const uint16_t *buf, int w, int h, uint8_t flags = 0);
+    bool reserveStrips();
+    // One strip of an area being sent (forEachStrip): area rows row to row + rows - 1, as panel rows y to
+    // y + h - 1 (h even, filler row included) and columns xa to xb - 1 (w before round clipping)
+    struct Strip
+    {
+        int row, rows;
+        int y, h;
+        int lead;     // 1 when the strip starts one row above row (the filler row of the bottom edge)
+        int w, xa, xb;
+        int step;     // rows of each window, h or 2 when the windows follow the circle
+        bool last;    // the last strip of the area
+        bool visible; // some of its columns are on the round panel
+    };
+    template <typename F>
+    bool forEachStrip(int x, int y, int push_w, int h, int row, int rows, bool filler_inside, F &&strip);
+    template <typename F>
+    bool forEachWindow(const Strip &s, F &&window);
+    bool stageArea(int x1, int y1, int w, int h, const uint16_t *bitmap, int stride, int row, bool area);
+    bool fillWindows(int xs, int ys, int w, int h, uint16_t color565, bool area);
+    bool reserveShadow();
+    uint16_t *acquireStrip();
+    uint16_t *acquireSolidStrip(uint16_t be, int count);
+    void signalFlushDone();
+    void waitTransfers();
+    static bool onColorDone(esp_lcd_panel_handle_t panel, void *user_ctx);
 
 public:
     Amoled();
@@ -58,8 +254,16 @@ public:
     uint8_t ID();
     char *name();
     bool begin();
-    bool drawBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w, int16_t h);
-    bool drawArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t *bitmap);
+    // Pixels in panel byte order, clipped to the screen; the source can be reused once this returns
+    bool drawBitmap(int16_t x, int16_t y, const uint16_t *bitmap, int16_t w, int16_t h);
+    bool drawBitmap(int16_t x, int16_t y, const uint16_t *src, int src_stride, int sx, int sy, int16_t w,
+                    int16_t h); // the w x h rectangle at (sx, sy) of a source src_stride pixels wide
+    // src_stride: pixels per row of the source, 0 when its rows are the width of the area (they may
+    // then be byte-swapped in place, the source is left untouched otherwise)
+    bool drawArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t *bitmap, int src_stride = 0);
+    // drawArea of an area all of one color (source order): the panel ends up the same, flush-done callback
+    // included, but the windows are sent from a strip filled with the color, nothing is staged
+    bool fillArea(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t color565);
     bool fillScreen(uint16_t color565);
     bool fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color565);
     bool fillRect(int16_t x, int16_t y, int16_t w, int16_t h, Color565 color)
@@ -67,6 +271,33 @@ public:
         return fillRect(x, y, w, h, static_cast<uint16_t>(color));
     }
     bool invertColor(bool invert);
+    bool setBrightness(uint8_t value); // 0 to 0xFF, now (waits for the transfers in flight), ends a fade
+    void fadeBrightness(uint8_t value, uint32_t duration_ms, AmoledFadeCurve curve = AMOLED_FADE_EASE_IN_OUT);
+    bool updateBrightness(); // steps a fade, call often from the task that flushes; true while fading
+    uint8_t brightness();    // level last sent to the panel
+    bool setPowerMode(uint8_t mode); // AmoledPowerMode flags, waits for the transfers in flight (and SLEEP_OUT_MS to wake)
+    uint8_t powerMode();
+    bool setPartialArea(int top, int bottom); // rows lit in partial mode, top to bottom - 1 (all by default)
+    void setPowerPolicy(AmoledPowerPolicy policy, void *user_ctx);
+    uint8_t updatePower(uint32_t inactive_ms); // applies the mode the policy returns, call from the task that flushes
+    const AmoledPowerStats &powerStats();
+    void resetPowerStats();
+    void setFlushDoneCallback(AmoledFlushDoneCb cb, void *user_ctx);
+    const AmoledFlushStats &flushStats();
+    void resetFlushStats();
+#if FLUSH_PROFILE
+    void endFrame(); // call after the last drawArea of a frame
+    const AmoledFlushProfile &flushProfile(); // last drawArea call (latency_us once it is done)
+    const AmoledFrameProfile &frameProfile(); // last frame whose flushes are all done
+    uint32_t frameCount();                    // frames whose flushes are all done
+#else
+    void endFrame() {}
+#endif
+#if TE_SYNC
+    bool waitTearingEffect(uint32_t timeout_ms); // wait for the next TE pulse, false when none came
+    uint32_t refreshPeriod();                    // panel refresh period (us), 0 until measured
+    int scanLine();                              // row the panel is reading, -1 until known
+#endif
 };
 
 #endif
\ No newline at end of file
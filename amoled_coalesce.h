@@ -0,0 +1,110 @@
+// Dirty-rectangle coalescing shared by the LVGL glue and the host tools
+// The areas invalidated during one frame are merged while one bigger panel window costs less
+// to send than the separate ones, counting the pixels on the wire and the setup of every window.
+// The LVGL glue grows each area as it is invalidated (coalesce_add), LVGL's own join then drops the
+// areas the grown one covers.
+//
+#ifndef AMOLED_COALESCE_H
+#define AMOLED_COALESCE_H
+
+#include <stdint.h>
+#include "board_config.h"
+#include "amoled_flush.h"
+#include "amoled_round.h"
+
+#define COALESCE_MAX_AREAS 32 // LV_INV_BUF_SIZE, the most areas LVGL collects in one frame
+
+// Inclusive area, like lv_area_t
+struct CoalesceRect
+{
+  int32_t x1, y1, x2, y2;
+};
+
+// Cost of flushing an area, in pixel bytes: Amoled::drawArea sends it in strips of STRIP_SIZE
+// bytes, each strip is one window clipped to the round panel and costs WINDOW_OVERHEAD_BYTES more
+static inline long coalesce_cost(const CoalesceRect &r)
+{
+  const int w = r.x2 - r.x1 + 1, h = r.y2 - r.y1 + 1;
+  if (w <= 0 || h <= 0)
+    return 0;
+  const int push_w = even_width(w);
+  const int rows = strip_rows(push_w, STRIP_SIZE);
+  long cost = 0;
+  for (int row = 0; row < h; row += rows)
+  {
+    const int push_h = even_width((h - row < rows) ? h - row : rows);
+    int xa = r.x1, xb = r.x1 + push_w;
+    if (round_clip(r.y1 + row, push_h, xa, xb))
+      cost += (long)(xb - xa) * push_h * (long)sizeof(uint16_t) + WINDOW_OVERHEAD_BYTES;
+  }
+  return cost;
+}
+
+static inline CoalesceRect coalesce_union(const CoalesceRect &a, const CoalesceRect &b)
+{
+  CoalesceRect u;
+  u.x1 = (a.x1 < b.x1) ? a.x1 : b.x1;
+  u.y1 = (a.y1 < b.y1) ? a.y1 : b.y1;
+  u.x2 = (a.x2 > b.x2) ? a.x2 : b.x2;
+  u.y2 = (a.y2 > b.y2) ? a.y2 : b.y2;
+  return u;
+}
+
+// Merge the n areas in place, always the pair that saves the most first, until no merge saves
+// anything (a merge that costs the same is taken, it leaves one area less to render).
+// Returns the new number of areas. The union of two even-aligned areas stays even-aligned.
+static inline int coalesce_areas(CoalesceRect *r, int n)
+{
+  if (n > COALESCE_MAX_AREAS)
+    return n;
+  long cost[COALESCE_MAX_AREAS];
+  for (int i = 0; i < n; i++)
+    cost[i] = coalesce_cost(r[i]);
+  for (;;)
+  {
+    long best_gain = -1, best_cost = 0;
+    int bi = -1, bj = -1;
+    for (int i = 0; i < n; i++)
+      for (int j = i + 1; j < n; j++)
+      {
+        // Overlapping areas are both sent in full when kept apart, so their sum is the right baseline
+        const long merged = coalesce_cost(coalesce_union(r[i], r[j]));
+        const long gain = cost[i] + cost[j] - merged;
+        if (gain > best_gain)
+        {
+          best_gain = gain;
+          best_cost = merged;
+          bi = i;
+          bj = j;
+        }
+      }
+    if (bi < 0)
+      return n;
+    r[bi] = coalesce_union(r[bi], r[bj]);
+    cost[bi] = best_cost;
+    r[bj] = r[n - 1];
+    cost[bj] = cost[n - 1];
+    n--;
+  }
+}
+
+// Adds the area a, invalidated now, to the n areas of the frame (coalesce_areas() left, none worth merging)
+// and merges it with the ones it pays to: a becomes the union to invalidate instead, which covers the
+// areas it absorbed. Returns the new number of areas; a is left alone once COALESCE_MAX_AREAS are there.
+static inline int coalesce_add(CoalesceRect *r, int n, CoalesceRect &a)
+{
+  if (n >= COALESCE_MAX_AREAS)
+    return n;
+  const CoalesceRect added = a;
+  r[n] = a;
+  n = coalesce_areas(r, n + 1);
+  for (int k = 0; k < n; k++)
+    if (r[k].x1 <= added.x1 && r[k].y1 <= added.y1 && r[k].x2 >= added.x2 && r[k].y2 >= added.y2)
+    {
+      a = r[k];
+      break;
+    }
+  return n;
+}
+
+#endif
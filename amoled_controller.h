@@ -0,0 +1,55 @@
+// What differs between the display controllers fitted to the board, known at compile time
+// (plain C/C++, no ESP-IDF or Arduino dependency)
+//
+// With AMOLED_CONTROLLER set in board_config.h the driver is built for one controller: the ID is
+// not read and AmoledController<AMOLED_CONTROLLER> turns every difference into a constant. With
+// AMOLED_CONTROLLER 0 the ID read at begin() picks one of them once, through amoled_controller().
+//
+// Both controllers share the window rules of amoled_flush.h (even width and height, 2-row minimum).
+//
+#ifndef AMOLED_CONTROLLER_H
+#define AMOLED_CONTROLLER_H
+
+#include <stdint.h>
+#include "board_config.h"
+
+template <uint8_t Id>
+struct AmoledController;
+
+template <>
+struct AmoledController<SH8601_ID>
+{
+  static constexpr uint8_t id = SH8601_ID;
+  static constexpr const char *name = SH8601_NAME;
+  static constexpr int x_offset = 0; // column of the first visible pixel in the panel memory
+};
+
+template <>
+struct AmoledController<CO5300_ID>
+{
+  static constexpr uint8_t id = CO5300_ID;
+  static constexpr const char *name = CO5300_NAME;
+  static constexpr int x_offset = 6;
+};
+
+// The same, for a controller only known at run time
+struct AmoledControllerInfo
+{
+  uint8_t id;
+  const char *name;
+  int x_offset;
+};
+
+template <uint8_t Id>
+constexpr AmoledControllerInfo amoled_controller_info()
+{
+  return {AmoledController<Id>::id, AmoledController<Id>::name, AmoledController<Id>::x_offset};
+}
+
+// Any ID other than the SH8601 one is driven as a CO5300, as the original driver did
+static inline AmoledControllerInfo amoled_controller(uint8_t id)
+{
+  return (id == SH8601_ID) ? amoled_controller_info<SH8601_ID>() : amoled_controller_info<CO5300_ID>();
+}
+
+#endif
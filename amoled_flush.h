@@ -0,0 +1,51 @@
+// Flush geometry helpers shared by the display driver and the host tools
+// (plain C/C++, no ESP-IDF or Arduino dependency)
+//
+#ifndef AMOLED_FLUSH_H
+#define AMOLED_FLUSH_H
+
+#include <stdint.h>
+#include "board_config.h"
+
+// The panel only accepts windows with an even width and an even height
+static inline int even_width(int w) { return (w & 1) ? (w + 1) : w; }
+
+// Number of rows of push_w pixels packed into one panel transaction (CASET/RASET/RAMWR):
+// as many as fit in budget_bytes, rounded down to an even count, never less than the 2-row minimum
+static inline int strip_rows(int push_w, int budget_bytes)
+{
+  int rows = budget_bytes / (push_w * (int)sizeof(uint16_t));
+  rows &= ~1;
+  return (rows < 2) ? 2 : rows;
+}
+
+// Number of panel transactions needed to push h rows in strips of `rows` rows
+static inline int strip_count(int h, int rows)
+{
+  return (h + rows - 1) / rows;
+}
+
+// Panel window left open by the last pixel write. A transfer that continues it (same columns, next
+// rows, inside the window) is sent with memory-write-continue (RAMWRC), without CASET/RASET/RAMWR.
+struct StreamWindow
+{
+  int x, w;   // columns of the window, w == 0 when no window is open
+  int next_y; // row the next pixel goes to
+  int end_y;  // end of the window (exclusive)
+};
+
+static inline bool stream_continues(const StreamWindow &s, int x, int y, int w, int h)
+{
+  return s.w && s.w == w && s.x == x && s.next_y == y && y + h <= s.end_y;
+}
+
+// Window to open for a transfer of rows y..y+h-1: down to bottom when later strips of the same
+// area may continue it, keeping the even height the panel needs
+static inline int stream_window_end(int y, int h, int bottom)
+{
+  if (bottom <= y + h)
+    return y + h;
+  return y + ((bottom - y) & ~1);
+}
+
+#endif
@@ -0,0 +1,126 @@
+// Visible area of the round panel, shared by the display driver and the host tools
+// Only the pixels inside the circle inscribed in the DISPLAY_WIDTH x DISPLAY_HEIGHT frame can be
+// seen, the flush path uses the per-row spans below to leave the corners out of its windows.
+//
+#ifndef AMOLED_ROUND_H
+#define AMOLED_ROUND_H
+
+#include <stdint.h>
+#include "board_config.h"
+
+// Visible columns x0..x1 (inclusive) of a panel row, x0 even and x1 odd so clipped windows stay even
+struct RoundSpan
+{
+  int16_t x0, x1;
+};
+
+static constexpr int round_isqrt(int v)
+{
+  int r = 0;
+  while ((r + 1) * (r + 1) <= v)
+    r++;
+  return r;
+}
+
+// Computed at compile time: a pixel is visible when its center lies inside the circle.
+// Doubled coordinates keep the half-pixel center of an even-sized frame in integers.
+struct RoundSpanTable
+{
+  RoundSpan row[DISPLAY_HEIGHT];
+
+  constexpr RoundSpanTable() : row()
+  {
+    const int diameter = (DISPLAY_WIDTH < DISPLAY_HEIGHT) ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+    for (int y = 0; y < DISPLAY_HEIGHT; y++)
+    {
+      const int dy = 2 * y - (DISPLAY_HEIGHT - 1);
+      const int rem = diameter * diameter - dy * dy;
+      if (rem < 0)
+      {
+        row[y].x0 = 1;
+        row[y].x1 = 0;
+        continue;
+      }
+      const int m = round_isqrt(rem);
+      int x0 = (DISPLAY_WIDTH - 1 - m + 1) / 2;
+      int x1 = (DISPLAY_WIDTH - 1 + m) / 2;
+      x0 &= ~1;
+      x1 |= 1;
+      if (x1 > DISPLAY_WIDTH - 1)
+        x1 = DISPLAY_WIDTH - 1;
+      row[y].x0 = (int16_t)x0;
+      row[y].x1 = (int16_t)x1;
+    }
+  }
+};
+
+static constexpr RoundSpanTable round_spans{};
+
+// Clip the window columns [xa, xb) of rows y..y+h-1 to the widest visible span of these rows.
+// Returns false when nothing of the window is visible. Windows starting on an odd column are left
+// as they are, trimming them would break the even alignment the panel needs.
+static inline bool round_clip(int y, int h, int &xa, int &xb)
+{
+#if DISPLAY_ROUND
+  if (xa & 1)
+    return true;
+  // The widest row of the window is the one closest to the middle of the panel
+  const int mid = (DISPLAY_HEIGHT - 1) / 2;
+  int yc = (y + h - 1 < mid) ? y + h - 1 : (y > mid + 1) ? y : mid;
+  if (yc < 0 || yc >= DISPLAY_HEIGHT)
+    return false;
+  const RoundSpan &s = round_spans.row[yc];
+  if (xa < s.x0)
+    xa = s.x0;
+  if (xb > s.x1 + 1)
+    xb = s.x1 + 1;
+  return xa < xb;
+#else
+  (void)y;
+  (void)h;
+  return xa < xb;
+#endif
+}
+
+// Whether sending rows y..y+h-1 as 2-row windows, each clipped to its own span, costs less than
+// one clipped window once the setup of every extra window (WINDOW_OVERHEAD_BYTES) is counted
+static inline bool round_split(int y, int h, int xa, int xb)
+{
+#if DISPLAY_ROUND
+  if (h <= 2 || (xa & 1))
+    return false;
+  int a = xa, b = xb;
+  if (!round_clip(y, h, a, b))
+    return false;
+  const long single = (long)(b - a) * h * 2;
+  long split = 0;
+  int windows = 0;
+  for (int r = 0; r < h && split < single; r += 2)
+  {
+    int pa = xa, pb = xb;
+    if (!round_clip(y + r, 2, pa, pb))
+      continue;
+    split += (long)(pb - pa) * 2 * 2 + (windows ? WINDOW_OVERHEAD_BYTES : 0);
+    windows++;
+  }
+  return split < single;
+#else
+  (void)y;
+  (void)h;
+  (void)xa;
+  (void)xb;
+  return false;
+#endif
+}
+
+// Whether the rectangle is entirely visible, so that clipping would not remove any pixel
+static inline bool round_inside(int x, int y, int w, int h)
+{
+  int xa = x, xb = x + w;
+  int top_a = x, top_b = x + w;
+  // The narrowest rows are the first and the last one
+  return round_clip(y, 1, top_a, top_b) && top_a == x && top_b == x + w &&
+         round_clip(y + h - 1, 1, xa, xb) && xa == x && xb == x + w;
+}
+
+#endif
@@ -0,0 +1,238 @@
+// Shadow of the panel memory, shared by the display driver and the host tools
+// The flush path compares each staged row against what the panel already holds and only sends
+// the columns that changed. Pixels are kept in source (LVGL) order.
+//
+#ifndef AMOLED_SHADOW_H
+#define AMOLED_SHADOW_H
+
+#include <stdint.h>
+#include <string.h>
+#include "board_config.h"
+#include "amoled_stage.h"
+
+// Shadow modes, select one with SHADOW_FRAMEBUFFER in board_config.h
+#define SHADOW_OFF 0
+#define SHADOW_COMPARE 1 // full copy of the panel memory (434 KB of PSRAM), exact
+#define SHADOW_HASH 2    // one hash per SHADOW_TILE pixels of a row (56 KB), a collision leaves a stale tile
+
+#define SHADOW_TILE 16
+#define SHADOW_TILES ((DISPLAY_WIDTH + SHADOW_TILE - 1) / SHADOW_TILE)
+
+struct AmoledShadow
+{
+  uint16_t *pixels; // SHADOW_COMPARE: DISPLAY_WIDTH x DISPLAY_HEIGHT pixels
+  uint32_t *hashes; // SHADOW_HASH: SHADOW_TILES hashes per row, 0 when the tile content is unknown
+};
+
+static inline size_t shadow_bytes()
+{
+#if SHADOW_FRAMEBUFFER == SHADOW_COMPARE
+  return (size_t)DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(uint16_t);
+#elif SHADOW_FRAMEBUFFER == SHADOW_HASH
+  return (size_t)SHADOW_TILES * DISPLAY_HEIGHT * sizeof(uint32_t);
+#else
+  return 0;
+#endif
+}
+
+// Attach the shadow to its memory (shadow_bytes() long); the panel content is unknown until written
+static inline void shadow_init(AmoledShadow &s, void *mem)
+{
+  s.pixels = (SHADOW_FRAMEBUFFER == SHADOW_COMPARE) ? (uint16_t *)mem : NULL;
+  s.hashes = (SHADOW_FRAMEBUFFER == SHADOW_HASH) ? (uint32_t *)mem : NULL;
+  if (mem)
+    memset(mem, 0, shadow_bytes());
+}
+
+// FNV-1a over pixel pairs, never 0 so that 0 can mean "unknown"
+static inline uint32_t shadow_hash(const uint16_t *src, int n, uint32_t seed)
+{
+  uint32_t h = (0x811C9DC5u ^ seed) * 16777619u;
+  int i = 0;
+  for (; i + 2 <= n; i += 2)
+    h = (h ^ ((uint32_t)src[i] | ((uint32_t)src[i + 1] << 16))) * 16777619u;
+  if (i < n)
+    h = (h ^ src[i]) * 16777619u;
+  return h ? h : 1;
+}
+
+// Compare n source pixels going to columns x..x+n-1 of panel row y with the shadow, and record them.
+// Returns false when the panel already holds them all, otherwise widens [a, b) to the changed columns.
+static inline bool shadow_row_diff(AmoledShadow &s, int y, int x, int n, const uint16_t *src, int &a, int &b)
+{
+#if SHADOW_FRAMEBUFFER == SHADOW_COMPARE
+  uint16_t *sh = s.pixels + y * DISPLAY_WIDTH + x;
+  if (memcmp(sh, src, n * sizeof(uint16_t)) == 0)
+    return false;
+  int i = 0, j = n;
+  while (sh[i] == src[i])
+    i++;
+  while (sh[j - 1] == src[j - 1])
+    j--;
+  memcpy(sh + i, src + i, (j - i) * sizeof(uint16_t));
+  if (x + i < a)
+    a = x + i;
+  if (x + j > b)
+    b = x + j;
+  return true;
+#elif SHADOW_FRAMEBUFFER == SHADOW_HASH
+  uint32_t *hs = s.hashes + y * SHADOW_TILES;
+  bool changed = false;
+  for (int t = x / SHADOW_TILE; t * SHADOW_TILE < x + n; t++)
+  {
+    const int t0 = t * SHADOW_TILE;
+    const int t1 = (t0 + SHADOW_TILE < DISPLAY_WIDTH) ? t0 + SHADOW_TILE : DISPLAY_WIDTH;
+    const int c0 = (t0 > x) ? t0 : x;
+    const int c1 = (t1 < x + n) ? t1 : x + n;
+    // The hash covers the columns of the tile written last, a partly covered tile only matches
+    // when the same columns are written again with the same pixels
+    const uint32_t h = shadow_hash(src + (c0 - x), c1 - c0, (uint32_t)((c0 - t0) << 8 | (c1 - t0)));
+    if (h == hs[t])
+      continue;
+    hs[t] = h;
+    if (c0 < a)
+      a = c0;
+    if (c1 > b)
+      b = c1;
+    changed = true;
+  }
+  return changed;
+#else
+  (void)s;
+  (void)y;
+  (void)src;
+  if (x < a)
+    a = x;
+  if (x + n > b)
+    b = x + n;
+  return true;
+#endif
+}
+
+// Diff rows y..y+h-1 (h even) of the window [wa, wb) against the shadow and call emit(ga, gb, gy, gh)
+// with the windows worth sending, gy relative to y. The changed columns of each row pair are widened
+// to even columns, and pairs are grouped while one window costs less than separate ones (every extra
+// window costs WINDOW_OVERHEAD_BYTES). src(r) gives the n source pixels of row r from column wa,
+// the columns from wa + n to wb are padding.
+// Returns the number of pixels left out because the panel holds them, or -1 when emit fails.
+template <typename Src, typename Emit>
+static inline long shadow_diff_window(AmoledShadow &s, int y, int h, int wa, int wb, int n, Src src, Emit emit)
+{
+  long unchanged = (long)(wb - wa) * h;
+  int ga = 0, gb = 0, gy = 0, gh = 0;
+  for (int p = 0; p < h; p += 2)
+  {
+    int a = wb, b = wa;
+    shadow_row_diff(s, y + p, wa, n, src(p), a, b);
+    shadow_row_diff(s, y + p + 1, wa, n, src(p + 1), a, b);
+    if (a >= b)
+      continue;
+    a &= ~1;
+    b = (b + 1) & ~1;
+    if (b > wb)
+      b = wb;
+    if (gh)
+    {
+      const int ma = (a < ga) ? a : ga;
+      const int mb = (b > gb) ? b : gb;
+      const long merged = (long)(mb - ma) * (p + 2 - gy);
+      const long apart = (long)(gb - ga) * gh + (long)(b - a) * 2 + WINDOW_OVERHEAD_BYTES / 2;
+      if (merged <= apart)
+      {
+        ga = ma;
+        gb = mb;
+        gh = p + 2 - gy;
+        continue;
+      }
+      if (!emit(ga, gb, gy, gh))
+        return -1;
+      unchanged -= (long)(gb - ga) * gh;
+    }
+    ga = a;
+    gb = b;
+    gy = p;
+    gh = 2;
+  }
+  if (gh)
+  {
+    if (!emit(ga, gb, gy, gh))
+      return -1;
+    unchanged -= (long)(gb - ga) * gh;
+  }
+  return unchanged;
+}
+
+// Record one pixel written to the panel outside of shadow_row_diff (the padding column)
+static inline void shadow_set(AmoledShadow &s, int x, int y, uint16_t c)
+{
+  if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT)
+    return;
+#if SHADOW_FRAMEBUFFER == SHADOW_COMPARE
+  if (s.pixels)
+    s.pixels[y * DISPLAY_WIDTH + x] = c;
+#elif SHADOW_FRAMEBUFFER == SHADOW_HASH
+  if (s.hashes)
+    s.hashes[y * SHADOW_TILES + x / SHADOW_TILE] = 0;
+  (void)c;
+#else
+  (void)s;
+  (void)x;
+  (void)y;
+  (void)c;
+#endif
+}
+
+// Record a rectangle written to the panel: a solid color, or panel-order pixels when src is set
+static inline void shadow_write(AmoledShadow &s, int x, int y, int w, int h, const uint16_t *src, int stride, uint16_t color)
+{
+  if (x + w > DISPLAY_WIDTH)
+    w = DISPLAY_WIDTH - x;
+  if (y + h > DISPLAY_HEIGHT)
+    h = DISPLAY_HEIGHT - y;
+#if SHADOW_FRAMEBUFFER == SHADOW_COMPARE
+  for (int r = 0; s.pixels && r < h; r++)
+  {
+    uint16_t *sh = s.pixels + (y + r) * DISPLAY_WIDTH + x;
+    if (src)
+      stage_row(sh, src + r * stride, w, w); // panel order back to source order
+    else
+      for (int i = 0; i < w; i++)
+        sh[i] = color;
+  }
+#elif SHADOW_FRAMEBUFFER == SHADOW_HASH
+  (void)src;
+  (void)stride;
+  (void)color;
+  for (int r = 0; s.hashes && r < h; r++)
+    for (int t = x / SHADOW_TILE; t * SHADOW_TILE < x + w; t++)
+      s.hashes[(y + r) * SHADOW_TILES + t] = 0;
+#else
+  (void)s;
+  (void)x;
+  (void)y;
+  (void)w;
+  (void)h;
+  (void)src;
+  (void)stride;
+  (void)color;
+#endif
+}
+
+// Forget what the panel holds in a rectangle (a transfer failed), so that the next flush sends it again
+static inline void shadow_forget(AmoledShadow &s, int x, int y, int w, int h)
+{
+#if SHADOW_FRAMEBUFFER == SHADOW_COMPARE
+  if (x + w > DISPLAY_WIDTH)
+    w = DISPLAY_WIDTH - x;
+  if (y + h > DISPLAY_HEIGHT)
+    h = DISPLAY_HEIGHT - y;
+  // Every shadow pixel is flipped, so that it differs from the content that could not be sent
+  for (int r = 0; s.pixels && r < h; r++)
+    for (int i = 0; i < w; i++)
+      s.pixels[(y + r) * DISPLAY_WIDTH + x + i] ^= 0xFFFF;
+#else
+  shadow_write(s, x, y, w, h, NULL, 0, 0);
+#endif
+}
+
+#endif
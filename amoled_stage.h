@@ -0,0 +1,136 @@
+// Pixel staging kernels shared by the display driver and the host tools
+// One pass copies a row of RGB565 pixels, swaps it to the panel byte order (big-endian)
+// and repeats the last pixel when the row is padded to an even width.
+//
+#ifndef AMOLED_STAGE_H
+#define AMOLED_STAGE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "board_config.h"
+
+// Kernel implementations, select one with AMOLED_STAGE_KERNEL (word kernels assume a little-endian CPU)
+#define AMOLED_STAGE_SCALAR 0 // one pixel at a time
+#define AMOLED_STAGE_SWAR32 1 // two pixels per 32-bit word (ESP32-S3)
+#define AMOLED_STAGE_SWAR64 2 // four pixels per 64-bit word (64-bit hosts)
+
+#ifndef AMOLED_STAGE_KERNEL
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define AMOLED_STAGE_KERNEL AMOLED_STAGE_SWAR64
+#else
+#define AMOLED_STAGE_KERNEL AMOLED_STAGE_SWAR32
+#endif
+#endif
+
+typedef uint32_t __attribute__((__may_alias__)) stage_u32_t;
+typedef uint64_t __attribute__((__may_alias__)) stage_u64_t;
+
+static inline uint16_t stage_px(uint16_t c)
+{
+#if AMOLED_SWAP_BYTES
+  return (uint16_t)((c << 8) | (c >> 8));
+#else
+  return c;
+#endif
+}
+
+static inline uint32_t stage_px2(uint32_t v)
+{
+#if AMOLED_SWAP_BYTES
+  return ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu);
+#else
+  return v;
+#endif
+}
+
+static inline uint64_t stage_px4(uint64_t v)
+{
+#if AMOLED_SWAP_BYTES
+  return ((v & 0x00FF00FF00FF00FFull) << 8) | ((v >> 8) & 0x00FF00FF00FF00FFull);
+#else
+  return v;
+#endif
+}
+
+// Stage w source pixels into push_w (w or w + 1) destination pixels
+static inline void stage_row_scalar(uint16_t *dst, const uint16_t *src, int w, int push_w)
+{
+  for (int i = 0; i < w; i++)
+    dst[i] = stage_px(src[i]);
+  if (push_w != w)
+    dst[w] = dst[w - 1];
+}
+
+static inline void stage_row_swar32(uint16_t *dst, const uint16_t *src, int w, int push_w)
+{
+  int i = 0;
+  // Peel one pixel so that the destination is word aligned
+  if (((uintptr_t)dst & 3) && w > 0)
+  {
+    dst[0] = stage_px(src[0]);
+    i = 1;
+  }
+  if ((((uintptr_t)(src + i)) & 3) == 0)
+  {
+    for (; i + 2 <= w; i += 2)
+      *(stage_u32_t *)(dst + i) = stage_px2(*(const stage_u32_t *)(src + i));
+  }
+  else if (i < w)
+  {
+    // Source and destination are not aligned the same way: memcpy realigns the pixels with the
+    // shifts it is tuned for, and the words are swapped in place in the destination
+    memcpy(dst + i, src + i, (w - i) * sizeof(uint16_t));
+    for (; i + 2 <= w; i += 2)
+      *(stage_u32_t *)(dst + i) = stage_px2(*(const stage_u32_t *)(dst + i));
+  }
+  for (; i < w; i++)
+    dst[i] = stage_px(src[i]);
+  if (push_w != w)
+    dst[w] = dst[w - 1];
+}
+
+static inline void stage_row_swar64(uint16_t *dst, const uint16_t *src, int w, int push_w)
+{
+  int i = 0;
+  // Peel pixels until both pointers are 8-byte aligned, if they can be
+  if ((((uintptr_t)dst ^ (uintptr_t)src) & 7) == 0)
+  {
+    for (; i < w && ((uintptr_t)(dst + i) & 7); i++)
+      dst[i] = stage_px(src[i]);
+    for (; i + 4 <= w; i += 4)
+      *(stage_u64_t *)(dst + i) = stage_px4(*(const stage_u64_t *)(src + i));
+  }
+  stage_row_swar32(dst + i, src + i, w - i, push_w - i);
+}
+
+static inline void stage_row(uint16_t *dst, const uint16_t *src, int w, int push_w)
+{
+#if AMOLED_STAGE_KERNEL == AMOLED_STAGE_SWAR64
+  stage_row_swar64(dst, src, w, push_w);
+#elif AMOLED_STAGE_KERNEL == AMOLED_STAGE_SWAR32
+  stage_row_swar32(dst, src, w, push_w);
+#else
+  stage_row_scalar(dst, src, w, push_w);
+#endif
+}
+
+// Copy a row already in panel order, the padding column repeats the last pixel
+static inline void stage_row_copy(uint16_t *dst, const uint16_t *src, int w, int push_w)
+{
+  memcpy(dst, src, w * sizeof(uint16_t));
+  for (int i = w; i < push_w; i++)
+    dst[i] = src[w - 1];
+}
+
+// Swap n pixels in place, for buffers sent without staging
+static inline void stage_swap_inplace(uint16_t *buf, int n)
+{
+#if AMOLED_SWAP_BYTES
+  stage_row(buf, buf, n, n);
+#else
+  (void)buf;
+  (void)n;
+#endif
+}
+
+#endif
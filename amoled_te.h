@@ -0,0 +1,39 @@
+// Tearing effect (TE) helpers shared by the display driver and the host tools
+// (plain C/C++, no ESP-IDF or Arduino dependency)
+//
+// The panel pulses its TE line when its scan reaches TE_SCANLINE (set in the init tables), then
+// reads its memory again from row 0, one row every period / DISPLAY_HEIGHT. Writes are not torn
+// as long as they never cross the row being read: the bus fills rows faster than the panel
+// reads them, so an area is safe to send when the scan is already below it, or still far enough
+// above it that the transfer stays ahead.
+//
+#ifndef AMOLED_TE_H
+#define AMOLED_TE_H
+
+#include <stdint.h>
+#include "board_config.h"
+
+#define TE_SCANLINE (DISPLAY_HEIGHT - 1) // the pulse comes at the end of the frame (0x44 parameter)
+
+// Row the panel reads since_us after a TE pulse
+static inline int te_scan_line(uint32_t since_us, uint32_t period_us)
+{
+  if (!period_us)
+    return 0;
+  const uint32_t rows = (uint32_t)((uint64_t)(since_us % period_us) * DISPLAY_HEIGHT / period_us);
+  return (int)((rows + TE_SCANLINE + 1) % DISPLAY_HEIGHT);
+}
+
+// Microseconds to wait before rows top..bottom-1 can be written with the scan at `line`, 0 when
+// they can be written now. An area as tall as the panel is never clear of the scan, it waits
+// for the scan to pass its bottom once and goes out right behind it.
+static inline uint32_t te_wait_us(int line, int top, int bottom, uint32_t period_us)
+{
+  const int start = top - TE_MARGIN_ROWS; // first row the scan must not be on
+  const int into = ((line - start) % DISPLAY_HEIGHT + DISPLAY_HEIGHT) % DISPLAY_HEIGHT;
+  if (into >= bottom - start)
+    return 0;
+  return (uint32_t)((uint64_t)(bottom - start - into) * period_us / DISPLAY_HEIGHT);
+}
+
+#endif
@@ -9,11 +9,21 @@
 
 #define CO5300_NAME "CO5300"    // Tested with this display controller typ
 #define SH8601_NAME "SH8601"
+#ifndef AMOLED_CONTROLLER
+#define AMOLED_CONTROLLER 0     // 0 reads the controller ID at begin(), SH8601_ID or CO5300_ID builds the driver for that controller only (amoled_controller.h)
+#endif
+#ifndef CONTROLLER_ID_READ_GPIO
+#define CONTROLLER_ID_READ_GPIO 1 // 1 bit-bangs the pins like the original driver, 0 reads the controller ID through the SPI peripheral (ID_READ_SPEED, not checked on SH8601 and CO5300 panels yet)
+#endif
 
 // Display config
 #define DISPLAY_WIDTH   466
 #define DISPLAY_HEIGHT  466
 #define LCD_BIT_PER_PIXEL 16
+#ifndef DISPLAY_ROUND
+#define DISPLAY_ROUND   1       // Round panel: flushes leave out the pixels outside the inscribed circle
+#endif
+#define AMOLED_SWAP_BYTES 1     // LVGL 9 renders little-endian RGB565, the panel expects big-endian: swap while staging
 
 // Display controller pins
 #define PIN_NUM_LCD_CS     9
@@ -23,11 +33,15 @@
 #define PIN_NUM_LCD_DATA2  13
 #define PIN_NUM_LCD_DATA3  14
 #define PIN_NUM_LCD_RST    21
+#ifndef PIN_NUM_LCD_TE
+#define PIN_NUM_LCD_TE     -1   // Tearing effect output of the panel, -1 when it is not wired to the ESP32
+#endif
 
 // Touch pins & configuration
 #define I2C_ADDR_FT3168 0x38
 #define PIN_NUM_TOUCH_SCL 48
 #define PIN_NUM_TOUCH_SDA 47
+#define PIN_NUM_TOUCH_INT -1     // Interrupt output of the FT3168, wakes the LVGL task on a touch; -1 when it is not wired (LVGL polls)
 #define I2C_PORT I2C_NUM_0
 #define I2C_FREQUENCY (300 * 1000)
 
@@ -41,6 +55,35 @@
 #define LCD_HOST SPI2_HOST          // SPI peripheral
 #define TRANSFER_SIZE 4092          // Controls the largest DMA-able chunk the SPI driver will handle
 #define BUS_SPEED 80 * 1000 * 1000  // SPI Bus speed
+#define ID_READ_SPEED 5 * 1000 * 1000 // SPI clock of the controller ID read, register reads are specified much slower than pixel writes
 #define TRANSFER_QUEUE_DEPTH 32     // It’s the SPI device’s queue size; you can raise it until you run out of RAM
+#ifndef STRIP_SIZE
+#define STRIP_SIZE TRANSFER_SIZE    // Bytes of pixels staged per panel transaction, rows are packed up to this size (DMA-capable RAM)
+#endif
+#ifndef WINDOW_OVERHEAD_BYTES
+#define WINDOW_OVERHEAD_BYTES 1000  // Cost of one more panel window (CASET/RASET/RAMWR setup), in pixel bytes sent in the same time
+#endif
+#ifndef STRIP_BUFFERS
+#define STRIP_BUFFERS 2             // Staging strips in the ring: the next strip is staged while the previous one is on the bus
+#endif
+#ifndef STREAM_WRITES
+#define STREAM_WRITES 1             // Strips that continue the window of the previous one are sent with RAMWRC (0x3C), without CASET/RASET
+#endif
+#ifndef SHADOW_FRAMEBUFFER
+#define SHADOW_FRAMEBUFFER 0        // Skip pixels the panel already holds: 0 off, 1 compare with a PSRAM copy of the panel, 2 compare per-tile hashes (amoled_shadow.h)
+#endif
+#define BRIGHTNESS_STEP_MS 16       // Shortest time between two brightness commands (0x51) of a fade, Amoled::fadeBrightness
+#define SLEEP_OUT_MS 120            // Wait after a sleep out (0x11) before pixels, and between two sleep in/out commands, Amoled::setPowerMode
+#ifndef TE_SYNC
+#define TE_SYNC 0                   // Follow the panel refresh on PIN_NUM_LCD_TE: 0 off, 1 LVGL renders once per refresh (sketch), 2 also holds back areas the scan line is about to cross (amoled_te.h)
+                                    // Off until measured on the board (FLUSH_PROFILE frame times with 0, 1 and 2): 0 also leaves the CO5300 init table as it was
+#endif
+#define TE_MARGIN_ROWS 16           // With TE_SYNC 2, rows the scan line must stay above an area for it to be sent ahead of the scan
+#ifndef FLUSH_PROFILE
+#define FLUSH_PROFILE 0             // Time and count every flush and frame (Amoled::frameProfile), 0 compiles the profiling out
+#endif
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 0              // Events kept in the trace ring (trace.h), a power of two streamed over serial by the sketch, 0 compiles the trace out
+#endif
 
 #endif
\ No newline at end of file
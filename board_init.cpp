@@ -0,0 +1,133 @@
+// Board bring-up in parallel FreeRTOS tasks
+//
+#include "board_init.h"
+#include <stdio.h>
+#include "esp_timer.h"
+#include "trace.h"
+
+uint32_t BoardInit::add(const char *name, BoardInitStep run, void *user_ctx, uint32_t after, BaseType_t core,
+                        uint32_t stack_size)
+{
+    if (count >= BOARD_INIT_MAX_STEPS || !run)
+        return 0;
+    Step &s = steps[count];
+    s = {};
+    s.name = name;
+    s.run = run;
+    s.user_ctx = user_ctx;
+    s.after = after;
+    s.stack_size = stack_size;
+    s.core = core;
+    s.owner = this;
+    return 1UL << count++;
+}
+
+void BoardInit::stepTask(void *arg)
+{
+    Step *s = (Step *)arg;
+    BoardInit *init = s->owner;
+    if (s->after)
+        xEventGroupWaitBits(init->group, s->after, pdFALSE, pdTRUE, portMAX_DELAY);
+    if (init->failed(s->after))
+        s->skipped = true;
+    else
+    {
+        TRACE_BEGIN(s->name);
+        s->start_us = esp_timer_get_time();
+        s->ok = s->run(s->user_ctx);
+        s->end_us = esp_timer_get_time();
+        TRACE_END(s->name);
+    }
+    // Setting the bit publishes ok and skipped to the tasks waiting for it
+    xEventGroupSetBits(init->group, 1UL << (s - init->steps));
+    vTaskDelete(NULL);
+}
+
+bool BoardInit::start()
+{
+    if (!group)
+        group = xEventGroupCreate();
+    if (!group)
+        return false;
+    // The steps run at the priority of the caller, the loop task in a sketch
+    const UBaseType_t priority = uxTaskPriorityGet(NULL);
+    bool ok = true;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint32_t bit = 1UL << i;
+        if (started & bit)
+            continue;
+        started |= bit;
+        if (xTaskCreatePinnedToCore(stepTask, steps[i].name, steps[i].stack_size, &steps[i], priority, NULL,
+                                    steps[i].core) != pdPASS)
+        {
+            steps[i].skipped = true;
+            xEventGroupSetBits(group, bit);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool BoardInit::wait(uint32_t mask, uint32_t timeout_ms)
+{
+    if (!group)
+        return false;
+    const TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    const EventBits_t bits = xEventGroupWaitBits(group, mask, pdFALSE, pdTRUE, ticks);
+    return (bits & mask) == mask && !failed(mask);
+}
+
+bool BoardInit::done(uint32_t mask)
+{
+    return group && (xEventGroupGetBits(group) & mask) == mask;
+}
+
+bool BoardInit::failed(uint32_t mask)
+{
+    if (!group)
+        return false;
+    const EventBits_t bits = xEventGroupGetBits(group) & mask;
+    for (uint8_t i = 0; i < count; i++)
+        if ((bits & (1UL << i)) && !steps[i].ok)
+            return true;
+    return false;
+}
+
+void BoardInit::mark(const char *name)
+{
+    if (markCount < BOARD_INIT_MAX_MARKS)
+        marks[markCount++] = {name, esp_timer_get_time()};
+}
+
+void BoardInit::printTimeline(void (*print)(const char *line))
+{
+    char line[128];
+    print("Boot timeline (ms since boot)");
+    snprintf(line, sizeof(line), "  %-12s %8s %8s %8s", "", "start", "end", "took");
+    print(line);
+    const EventBits_t bits = group ? xEventGroupGetBits(group) : 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const Step &s = steps[i];
+        int n = snprintf(line, sizeof(line), "  %-12s", s.name);
+        if (!(bits & (1UL << i)))
+            n += snprintf(line + n, sizeof(line) - n, " %8s", s.start_us ? "running" : "waiting");
+        else if (s.skipped)
+            n += snprintf(line + n, sizeof(line) - n, " %8s", "skipped");
+        else
+            n += snprintf(line + n, sizeof(line) - n, " %8.1f %8.1f %8.1f%s", s.start_us / 1000.0, s.end_us / 1000.0,
+                          (s.end_us - s.start_us) / 1000.0, s.ok ? "" : "  failed");
+        // The steps it waited for
+        for (uint8_t j = 0; j < count && n < (int)sizeof(line); j++)
+            if (s.after & (1UL << j))
+                n += snprintf(line + n, sizeof(line) - n, "%s%s", (s.after & ((1UL << j) - 1)) ? ", " : "  after ",
+                              steps[j].name);
+        print(line);
+    }
+    for (uint8_t i = 0; i < markCount; i++)
+    {
+        snprintf(line, sizeof(line), "  %-12s %8.1f", marks[i].name, marks[i].us / 1000.0);
+        print(line);
+    }
+}
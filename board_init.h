@@ -0,0 +1,58 @@
+// Board bring-up in parallel: each step runs in its own FreeRTOS task as soon as the steps it depends on are done
+//
+#ifndef BOARD_INIT_H
+#define BOARD_INIT_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+#define BOARD_INIT_MAX_STEPS 16 // Steps of one BoardInit, each one is a bit of its event group (24 at most)
+#define BOARD_INIT_MAX_MARKS 4  // Points of the timeline that are not steps (BoardInit::mark)
+
+// A bring-up step, false when it failed: the steps that depend on it are not run
+typedef bool (*BoardInitStep)(void *user_ctx);
+
+class BoardInit
+{
+private:
+    struct Step
+    {
+        const char *name;
+        BoardInitStep run;
+        void *user_ctx;
+        uint32_t after;       // steps to wait for
+        uint32_t stack_size;
+        BaseType_t core;
+        int64_t start_us, end_us; // esp_timer time, 0 until the step starts and ends
+        bool ok, skipped;
+        BoardInit *owner;
+    };
+    struct Mark
+    {
+        const char *name;
+        int64_t us;
+    };
+    Step steps[BOARD_INIT_MAX_STEPS];
+    uint8_t count = 0;
+    Mark marks[BOARD_INIT_MAX_MARKS];
+    uint8_t markCount = 0;
+    uint32_t started = 0; // steps whose task was created
+    EventGroupHandle_t group = nullptr;
+    static void stepTask(void *arg);
+
+public:
+    // Adds a step run once every step of the mask `after` is done, returns its bit (0 when full)
+    // Pin steps that allocate interrupts (SPI, I2C, GPIO) to the core their driver is used from
+    uint32_t add(const char *name, BoardInitStep run, void *user_ctx = nullptr, uint32_t after = 0,
+                 BaseType_t core = tskNO_AFFINITY, uint32_t stack_size = 4096);
+    bool start();                                             // starts the tasks of the steps added so far
+    bool wait(uint32_t mask, uint32_t timeout_ms = UINT32_MAX); // true once they are all done and none failed
+    bool done(uint32_t mask);                                 // never blocks, true when they are all done
+    bool failed(uint32_t mask);                               // true when one of them failed or was skipped
+    void mark(const char *name);                              // records a point of the timeline, e.g. the first frame
+    void printTimeline(void (*print)(const char *line));      // one line per step and mark, in ms since boot
+};
+
+#endif
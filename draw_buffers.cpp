@@ -0,0 +1,171 @@
+// LVGL draw buffers and their boot-time tuner
+//
+#include "draw_buffers.h"
+#include <stdio.h>
+#include <src/display/lv_display_private.h> // flush callback and state of the display, for the benchmark
+#include "board_config.h"
+#include "esp_timer.h"
+
+size_t draw_buffer_size(const DrawBufferStrategy &s)
+{
+    return (size_t)DISPLAY_WIDTH * s.lines * (LV_COLOR_DEPTH / 8);
+}
+
+// Flush callback while the rendering alone is timed: the areas are dropped
+static void noop_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+    lv_display_flush_ready(disp);
+}
+
+uint32_t draw_bench_frames(lv_display_t *disp, int frames, void (*change)(int frame, void *ctx), void *ctx)
+{
+    const int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < frames; i++)
+    {
+        if (change)
+            change(i, ctx);
+        else
+            lv_obj_invalidate(lv_display_get_screen_active(disp));
+        lv_refr_now(disp);
+    }
+    // The last frame counts once it has left the bus, like LVGL waits for it
+    if (disp->flushing && disp->flush_wait_cb)
+        disp->flush_wait_cb(disp);
+    while (disp->flushing)
+    {
+    }
+    return frames > 0 ? (uint32_t)((esp_timer_get_time() - t0) / frames) : 0;
+}
+
+bool DrawBuffers::alloc(const DrawBufferStrategy &strategy)
+{
+    const size_t size = draw_buffer_size(strategy);
+    void *b[2] = {};
+    for (int i = 0; i < strategy.count && i < 2; i++)
+        if (!(b[i] = heap_caps_malloc(size, strategy.caps)))
+        {
+            heap_caps_free(b[0]);
+            return false;
+        }
+    release();
+    current = &strategy;
+    bufs[0] = b[0];
+    bufs[1] = b[1];
+    return true;
+}
+
+void DrawBuffers::release()
+{
+    heap_caps_free(bufs[0]);
+    heap_caps_free(bufs[1]);
+    bufs[0] = bufs[1] = nullptr;
+    current = nullptr;
+}
+
+bool DrawBuffers::apply(lv_display_t *disp)
+{
+    if (!current)
+        return false;
+    lv_display_set_buffers(disp, bufs[0], bufs[1], draw_buffer_size(*current), current->mode);
+    // In DIRECT mode the buffers are the screen: new ones hold nothing yet
+    lv_obj_invalidate(lv_display_get_screen_active(disp));
+    return true;
+}
+
+int DrawBuffers::tune(lv_display_t *disp, const DrawBufferStrategy *list, int count, size_t sram_budget,
+                      size_t psram_budget, DrawBufferResult *results, int frames, void (*change)(int frame, void *ctx),
+                      void *ctx)
+{
+    if (!current)
+        return -1; // the display needs buffers to come back to
+    const lv_display_flush_cb_t flush = disp->flush_cb;
+    int best = -1;
+    uint32_t best_us = UINT32_MAX;
+    for (int i = 0; i < count; i++)
+    {
+        DrawBufferResult &r = results[i];
+        r = {};
+        const size_t bytes = draw_buffer_size(list[i]) * list[i].count;
+        if (bytes > ((list[i].caps & MALLOC_CAP_INTERNAL) ? sram_budget : psram_budget))
+        {
+            r.status = DrawBufferResult::OVER_BUDGET;
+            continue;
+        }
+        // The strategy in use is measured with its own buffers, the others with buffers allocated for the run
+        DrawBuffers trial;
+        DrawBuffers *use = this;
+        if (&list[i] != current)
+        {
+            if (!trial.alloc(list[i]))
+            {
+                r.status = DrawBufferResult::NO_MEMORY;
+                continue;
+            }
+            use = &trial;
+        }
+        use->apply(disp);
+        lv_display_set_flush_cb(disp, noop_flush);
+        r.render_us = draw_bench_frames(disp, frames);
+        if (change)
+            r.change_render_us = draw_bench_frames(disp, frames, change, ctx);
+        lv_display_set_flush_cb(disp, flush);
+        r.frame_us = draw_bench_frames(disp, frames);
+        if (change)
+            r.change_frame_us = draw_bench_frames(disp, frames, change, ctx);
+        r.status = DrawBufferResult::MEASURED;
+        // Nothing is in flight any more: the trial buffers can go
+        apply(disp);
+        const uint32_t us = r.frame_us + r.change_frame_us;
+        if (us < best_us)
+        {
+            best = i;
+            best_us = us;
+        }
+    }
+    if (best < 0 || &list[best] == current)
+        return best;
+
+    DrawBuffers chosen;
+    if (!chosen.alloc(list[best]))
+    {
+        // Kept the buffers in use
+        for (int i = 0; i < count; i++)
+            if (&list[i] == current)
+                return i;
+        return -1;
+    }
+    chosen.apply(disp);
+    release();
+    current = chosen.current;
+    bufs[0] = chosen.bufs[0];
+    bufs[1] = chosen.bufs[1];
+    chosen.current = nullptr;
+    chosen.bufs[0] = chosen.bufs[1] = nullptr;
+    return best;
+}
+
+void DrawBuffers::printResults(const DrawBufferStrategy *list, const DrawBufferResult *results, int count, int best,
+                               void (*print)(const char *line))
+{
+    char line[128];
+    print("Draw buffers (us per frame: full screen, then the change)");
+    snprintf(line, sizeof(line), "  %-26s %6s %8s %8s %8s %8s", "", "KB", "render", "frame", "render", "frame");
+    print(line);
+    for (int i = 0; i < count; i++)
+    {
+        const DrawBufferResult &r = results[i];
+        int n = snprintf(line, sizeof(line), "  %-26s %6u", list[i].name,
+                         (unsigned)(draw_buffer_size(list[i]) * list[i].count / 1024));
+        if (r.status == DrawBufferResult::OVER_BUDGET)
+            snprintf(line + n, sizeof(line) - n, " %8s", "over budget");
+        else if (r.status == DrawBufferResult::NO_MEMORY)
+            snprintf(line + n, sizeof(line) - n, " %8s", "no memory");
+        else
+            snprintf(line + n, sizeof(line) - n, " %8lu %8lu %8lu %8lu%s", (unsigned long)r.render_us,
+                     (unsigned long)r.frame_us, (unsigned long)r.change_render_us, (unsigned long)r.change_frame_us,
+                     i == best ? "  <- kept" : "");
+        print(line);
+    }
+}
@@ -0,0 +1,70 @@
+// LVGL draw buffers: where they live, how many rows they hold and the render mode that goes with them,
+// with a boot-time benchmark that picks the fastest strategy within a RAM budget
+//
+#ifndef DRAW_BUFFERS_H
+#define DRAW_BUFFERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lvgl.h>
+#include "esp_heap_caps.h"
+
+// Heap of the buffers: internal RAM is much faster to render into, and the display driver can send
+// bands from it without copying them (zero-copy), but it only fits bands of a few dozen rows
+#define DRAW_BUF_SRAM (MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL)
+#define DRAW_BUF_PSRAM (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+
+struct DrawBufferStrategy
+{
+    const char *name;
+    lv_display_render_mode_t mode; // PARTIAL renders the areas in bands; DIRECT and FULL need full-screen buffers
+    uint32_t caps;                 // DRAW_BUF_SRAM or DRAW_BUF_PSRAM
+    uint16_t lines;                // rows of a buffer, DISPLAY_HEIGHT for a full-screen one
+    uint8_t count;                 // 2: LVGL renders into one buffer while the other one is sent
+};
+
+// Bytes of one buffer of the strategy
+size_t draw_buffer_size(const DrawBufferStrategy &s);
+
+// Average time of a frame (us), rendered by lv_refr_now(): the whole screen when `change` is null,
+// otherwise what it changes before each frame (its argument is the number of the frame)
+uint32_t draw_bench_frames(lv_display_t *disp, int frames, void (*change)(int frame, void *ctx) = nullptr,
+                           void *ctx = nullptr);
+
+// What the tuner measured for one strategy, in us per frame
+struct DrawBufferResult
+{
+    enum
+    {
+        MEASURED,
+        OVER_BUDGET,
+        NO_MEMORY,
+    } status;
+    uint32_t render_us;        // full screen, the flush to the panel left out
+    uint32_t frame_us;         // full screen, sent to the panel
+    uint32_t change_render_us; // the change of the tuner, 0 without one
+    uint32_t change_frame_us;
+};
+
+class DrawBuffers
+{
+private:
+    const DrawBufferStrategy *current = nullptr;
+    void *bufs[2] = {};
+
+public:
+    bool alloc(const DrawBufferStrategy &strategy); // the buffers held before are kept when it fails
+    void release();
+    bool apply(lv_display_t *disp);                 // sets the buffers and the render mode of the display
+    const DrawBufferStrategy *strategy() const { return current; }
+
+    // Measures each strategy whose buffers fit in the budget of their heap (bytes), the display using
+    // each one in turn, and keeps the fastest one: the lowest frame time, full screen plus `change`.
+    // Returns its index in `list` (-1 when none could be measured, the buffers held are kept)
+    int tune(lv_display_t *disp, const DrawBufferStrategy *list, int count, size_t sram_budget, size_t psram_budget,
+             DrawBufferResult *results, int frames, void (*change)(int frame, void *ctx) = nullptr, void *ctx = nullptr);
+    static void printResults(const DrawBufferStrategy *list, const DrawBufferResult *results, int count, int best,
+                             void (*print)(const char *line));
+};
+
+#endif
@@ -0,0 +1,138 @@
+// LVGL draw unit sending band-wide solid fills to the panel
+//
+#include "fill_unit.h"
+#include <src/display/lv_display_private.h>
+#include <src/draw/lv_draw_private.h>
+
+// Above the ids of LVGL's own draw units (DRAW_UNIT_ID_* in src/draw)
+#define FILL_UNIT_ID 32
+
+struct FillDrawUnit
+{
+    lv_draw_unit_t base; // first, LVGL only knows this part
+    FillUnit *owner;
+};
+
+bool FillUnit::begin(lv_display_t *display)
+{
+    FillDrawUnit *unit = (FillDrawUnit *)lv_draw_create_unit(sizeof(FillDrawUnit));
+    if (!unit)
+        return false;
+    unit->owner = this;
+    unit->base.evaluate_cb = evaluate;
+    unit->base.dispatch_cb = dispatch;
+    disp = display;
+    lv_display_add_event_cb(disp, onRenderStart, LV_EVENT_RENDER_START, this);
+    return true;
+}
+
+bool FillUnit::take(const lv_area_t *area, uint16_t *color565)
+{
+    const bool whole = solid && lv_area_is_in(area, &band, 0);
+    reset(); // the band is done with
+    if (!whole)
+        return false;
+    *color565 = color;
+    st.sent++;
+    return true;
+}
+
+void FillUnit::reset()
+{
+    pending = nullptr;
+    pendingRender = false;
+    solid = false;
+}
+
+void FillUnit::onRenderStart(lv_event_t *e)
+{
+    // A flush callback that does not call take() (the render benchmarks) leaves the last band behind
+    ((FillUnit *)lv_event_get_user_data(e))->reset();
+}
+
+// An opaque rectangle of one color over the whole band, drawn straight on the display's buffer. DIRECT
+// mode is left out: its buffers keep the pixels of earlier frames, and LVGL copies them between the two.
+bool FillUnit::claimable(const lv_draw_task_t *t) const
+{
+    if (t->type != LV_DRAW_TASK_TYPE_FILL || disp->render_mode == LV_DISPLAY_RENDER_MODE_DIRECT)
+        return false;
+    const lv_draw_fill_dsc_t *dsc = (const lv_draw_fill_dsc_t *)t->draw_dsc;
+    const lv_layer_t *layer = dsc->base.layer;
+    return layer == disp->layer_head && layer->color_format == LV_COLOR_FORMAT_RGB565 && dsc->opa >= LV_OPA_MAX &&
+           dsc->radius == 0 && dsc->grad.dir == LV_GRAD_DIR_NONE && lv_area_is_in(&disp->refreshed_area, &t->area, 0) &&
+           lv_area_is_in(&disp->refreshed_area, &t->clip_area, 0);
+}
+
+// The fill in the draw buffer after all, for what gets drawn on it
+void FillUnit::renderBand(lv_layer_t *layer)
+{
+    lv_draw_buf_t *buf = layer->draw_buf;
+    const int32_t w = lv_area_get_width(&band);
+    for (int32_t y = band.y1; y <= band.y2; y++)
+    {
+        uint16_t *row = (uint16_t *)lv_draw_buf_goto_xy(buf, band.x1 - layer->buf_area.x1, y - layer->buf_area.y1);
+        for (int32_t x = 0; x < w; x++)
+            row[x] = color;
+    }
+    st.rendered++;
+}
+
+// Called by LVGL on every task added, in the order they are drawn
+int32_t FillUnit::evaluate(lv_draw_unit_t *unit, lv_draw_task_t *t)
+{
+    FillUnit *self = ((FillDrawUnit *)unit)->owner;
+    if (!self->disp || lv_refr_get_disp_refreshing() != self->disp)
+        return 0;
+    if (!lv_area_is_equal(&self->band, &self->disp->refreshed_area))
+    {
+        self->reset(); // a new band
+        self->band = self->disp->refreshed_area;
+    }
+    if (self->claimable(t))
+    {
+        // It covers whatever was drawn on the band before, and an earlier claimed fill
+        const lv_draw_fill_dsc_t *dsc = (const lv_draw_fill_dsc_t *)t->draw_dsc;
+        t->preferred_draw_unit_id = FILL_UNIT_ID;
+        t->preference_score = 0;
+        self->pending = t;
+        self->pendingRender = false;
+        self->solid = false;
+        self->color = lv_color_to_u16(dsc->color);
+        self->st.claimed++;
+        return 0;
+    }
+    lv_layer_t *layer = ((const lv_draw_dsc_base_t *)t->draw_dsc)->layer;
+    if (layer != self->disp->layer_head)
+        return 0; // drawn on a layer of its own, it comes back as a LAYER task
+    if (self->pending)
+        self->pendingRender = true; // the fill runs before this task, and renders then
+    else if (self->solid)
+    {
+        // Every task before it has run, and this one cannot start before it returns
+        self->renderBand(layer);
+        self->solid = false;
+    }
+    return 0;
+}
+
+int32_t FillUnit::dispatch(lv_draw_unit_t *unit, lv_layer_t *layer)
+{
+    FillUnit *self = ((FillDrawUnit *)unit)->owner;
+    lv_draw_task_t *t = lv_draw_get_next_available_task(layer, NULL, FILL_UNIT_ID);
+    if (!t)
+        return LV_DRAW_UNIT_IDLE;
+    // A claimed fill other than the pending one is covered by a later fill of the band: none of it shows
+    if (t == self->pending)
+    {
+        if (self->pendingRender && !lv_draw_layer_alloc_buf(layer))
+            return LV_DRAW_UNIT_IDLE;
+        self->pending = nullptr;
+        if (self->pendingRender)
+            self->renderBand(layer);
+        else
+            self->solid = true;
+    }
+    t->state = LV_DRAW_TASK_STATE_READY;
+    lv_draw_dispatch_request();
+    return 1;
+}
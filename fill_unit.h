@@ -0,0 +1,51 @@
+// LVGL draw unit for the opaque solid fills that cover a whole band (a plain screen background, an
+// opaque panel larger than the band): instead of the SW renderer writing them into the draw buffer, and
+// the display driver staging and sending them pixel by pixel, the band is sent with Amoled::fillArea
+// from a DMA strip already holding the color.
+//
+// The fill is claimed when LVGL adds it, but LVGL keeps adding the tasks of the band after that: it is
+// left out of the buffer, and drawn into it only once something else is drawn on the band (before
+// that task can run). A band that got nothing else is handed to the flush callback by take().
+// Every callback runs in the task that calls lv_timer_handler(), and so does the flush callback.
+//
+#ifndef FILL_UNIT_H
+#define FILL_UNIT_H
+
+#include <stdint.h>
+#include <lvgl.h>
+
+// What the unit did, since the last resetStats()
+struct FillUnitStats
+{
+    uint32_t claimed;  // fills taken from the SW renderer
+    uint32_t sent;     // bands sent as one color, none of their pixels rendered
+    uint32_t rendered; // claimed fills drawn into the buffer after all, something was drawn on them
+};
+
+class FillUnit
+{
+private:
+    lv_display_t *disp = nullptr;
+    lv_draw_task_t *pending = nullptr; // claimed fill not dispatched yet
+    bool pendingRender = false;        // something was added on the band after it
+    bool solid = false;                // the band is the fill alone, its pixels are not in the buffer
+    lv_area_t band = {};               // the band of the fill (the area LVGL refreshes)
+    uint16_t color = 0;                // RGB565, LVGL order
+    FillUnitStats st = {};
+    bool claimable(const lv_draw_task_t *t) const;
+    void renderBand(lv_layer_t *layer);
+    void reset();
+    static int32_t evaluate(lv_draw_unit_t *unit, lv_draw_task_t *t);
+    static int32_t dispatch(lv_draw_unit_t *unit, lv_layer_t *layer);
+    static void onRenderStart(lv_event_t *e);
+
+public:
+    bool begin(lv_display_t *display); // after lv_init(), on the display in PARTIAL or FULL render mode
+    // In the flush callback: true when the area is a band of one color (RGB565, LVGL order) whose pixels
+    // were never rendered, to send with Amoled::fillArea instead of the draw buffer
+    bool take(const lv_area_t *area, uint16_t *color565);
+    const FillUnitStats &stats() const { return st; }
+    void resetStats() { st = {}; }
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#include "driver/spi_master.h"
 #include "esp_check.h"
 #include "esp_lcd_panel_interface.h"
 #include "esp_lcd_panel_io.h"
@@ -21,6 +22,7 @@
 #include "esp_lcd_panel_commands.h"
 #include "esp_log.h"
 #include "esp_rom_sys.h"
+#include "esp_attr.h"
 
 #define LCD_OPCODE_WRITE_CMD        (0x02ULL)
 #define LCD_OPCODE_READ_CMD         (0x03ULL)
@@ -49,6 +51,8 @@ typedef struct {
     uint8_t colmod_val; // save surrent value of LCD_CMD_COLMOD register
     const panel_lcd_init_cmd_t *init_cmds;
     uint16_t init_cmds_size;
+    amoled_color_done_cb_t color_done_cb;
+    void *color_done_ctx;
     struct {
         unsigned int use_qspi_interface: 1;
         unsigned int reset_level: 1;
@@ -253,10 +257,8 @@ static esp_err_t amoled_init(esp_lcd_panel_t *lcd_panel)
     return ESP_OK;
 }
 
-static esp_err_t amoled_draw_bitmap(esp_lcd_panel_t *lcd_panel, int x_start, int y_start, int x_end, int y_end, const void *color_data)
+static esp_err_t set_window(amoled_panel_t *panel, int x_start, int y_start, int x_end, int y_end)
 {
-    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
-    assert((x_start < x_end) && (y_start < y_end) && "start position must be smaller than end position");
     esp_lcd_panel_io_handle_t io = panel->io;
 
     x_start += panel->x_gap ;
@@ -277,6 +279,16 @@ static esp_err_t amoled_draw_bitmap(esp_lcd_panel_t *lcd_panel, int x_start, int
         ((y_end - 1) >> 8) & 0xFF,
         (y_end - 1) & 0xFF,
     }, 4), TAG, "send command failed");
+    return ESP_OK;
+}
+
+static esp_err_t amoled_draw_bitmap(esp_lcd_panel_t *lcd_panel, int x_start, int y_start, int x_end, int y_end, const void *color_data)
+{
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    assert((x_start < x_end) && (y_start < y_end) && "start position must be smaller than end position");
+    esp_lcd_panel_io_handle_t io = panel->io;
+
+    ESP_RETURN_ON_ERROR(set_window(panel, x_start, y_start, x_end, y_end), TAG, "set window failed");
     // transfer frame buffer
     size_t len = (x_end - x_start) * (y_end - y_start) * panel->fb_bits_per_pixel / 8;
     tx_color(panel, io, LCD_CMD_RAMWR, color_data, len);
@@ -284,6 +296,134 @@ static esp_err_t amoled_draw_bitmap(esp_lcd_panel_t *lcd_panel, int x_start, int
     return ESP_OK;
 }
 
+esp_err_t esp_amoled_panel_set_window(esp_lcd_panel_handle_t lcd_panel, int x_start, int y_start, int x_end, int y_end)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel && x_start < x_end && y_start < y_end, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    return set_window(panel, x_start, y_start, x_end, y_end);
+}
+
+esp_err_t esp_amoled_panel_write_color(esp_lcd_panel_handle_t lcd_panel, const void *color_data, size_t len, bool continue_write)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel && color_data && len, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    // RAMWR starts at the top left corner of the window, RAMWRC goes on where the last write stopped
+    return tx_color(panel, panel->io, continue_write ? LCD_CMD_RAMWRC : LCD_CMD_RAMWR, color_data, len);
+}
+
+esp_err_t esp_amoled_panel_set_brightness(esp_lcd_panel_handle_t lcd_panel, uint8_t level)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    return tx_param(panel, panel->io, LCD_CMD_WRDISBV, (uint8_t[]) {
+        level
+    }, 1);
+}
+
+esp_err_t esp_amoled_panel_set_idle(esp_lcd_panel_handle_t lcd_panel, bool idle)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    return tx_param(panel, panel->io, idle ? LCD_CMD_IDMON : LCD_CMD_IDMOFF, NULL, 0);
+}
+
+esp_err_t esp_amoled_panel_set_partial(esp_lcd_panel_handle_t lcd_panel, int y_start, int y_end)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    esp_lcd_panel_io_handle_t io = panel->io;
+
+    if (y_end <= y_start) {
+        return tx_param(panel, io, LCD_CMD_NORON, NULL, 0);
+    }
+    y_start += panel->y_gap;
+    y_end += panel->y_gap;
+    ESP_RETURN_ON_ERROR(tx_param(panel, io, LCD_CMD_PTLAR, (uint8_t[]) {
+        (y_start >> 8) & 0xFF,
+        y_start & 0xFF,
+        ((y_end - 1) >> 8) & 0xFF,
+        (y_end - 1) & 0xFF,
+    }, 4), TAG, "send command failed");
+    return tx_param(panel, io, LCD_CMD_PTLON, NULL, 0);
+}
+
+esp_err_t esp_amoled_panel_sleep(esp_lcd_panel_handle_t lcd_panel, bool sleep)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    return tx_param(panel, panel->io, sleep ? LCD_CMD_SLPIN : LCD_CMD_SLPOUT, NULL, 0);
+}
+
+esp_err_t esp_amoled_read_id(spi_host_device_t host, uint8_t *id)
+{
+    ESP_RETURN_ON_FALSE(id, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    // Same reset pulse as amoled_reset()
+    gpio_config_t io_conf = {
+        .mode = GPIO_MODE_OUTPUT,
+        .pin_bit_mask = 1ULL << PIN_NUM_LCD_RST,
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&io_conf), TAG, "configure GPIO for RST line failed");
+    gpio_set_level(PIN_NUM_LCD_RST, 1);
+    gpio_set_level(PIN_NUM_LCD_RST, 0);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    gpio_set_level(PIN_NUM_LCD_RST, 1);
+    vTaskDelay(pdMS_TO_TICKS(150));
+
+    // Opcode, 24-bit address holding the register, then the answer on D0: the panel reads in single-line mode
+    const spi_device_interface_config_t dev_config = {
+        .command_bits = 8,
+        .address_bits = 24,
+        .mode = 0,
+        .clock_speed_hz = ID_READ_SPEED,
+        .spics_io_num = PIN_NUM_LCD_CS,
+        .flags = SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX,
+        .queue_size = 1,
+    };
+    spi_device_handle_t dev = NULL;
+    ESP_RETURN_ON_ERROR(spi_bus_add_device(host, &dev_config, &dev), TAG, "add ID read device failed");
+    // A controller that does not answer leaves D0 floating: pulled up, as for the bit-banged read
+    gpio_pullup_en(PIN_NUM_LCD_DATA0);
+    spi_transaction_t t = {
+        .flags = SPI_TRANS_USE_RXDATA,
+        .cmd = LCD_OPCODE_READ_CMD,
+        .addr = 0xDA << 8,
+        .rxlength = 8,
+    };
+    esp_err_t ret = spi_device_polling_transmit(dev, &t);
+    spi_bus_remove_device(dev);
+    // D0 goes back to the QSPI bus as it was configured, without the pull-up
+    gpio_pullup_dis(PIN_NUM_LCD_DATA0);
+    ESP_RETURN_ON_ERROR(ret, TAG, "ID read failed");
+    *id = t.rx_data[0];
+    ESP_LOGI("lcd_Model", "0x%02x", *id);
+    return ESP_OK;
+}
+
+static bool IRAM_ATTR amoled_color_trans_done(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+{
+    (void)io;
+    (void)edata;
+    amoled_panel_t *panel = (amoled_panel_t *)user_ctx;
+    if (panel->color_done_cb) {
+        return panel->color_done_cb(&panel->base, panel->color_done_ctx);
+    }
+    return false;
+}
+
+esp_err_t esp_amoled_panel_register_color_done_cb(esp_lcd_panel_handle_t lcd_panel, amoled_color_done_cb_t cb, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(lcd_panel, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
+    const esp_lcd_panel_io_callbacks_t cbs = {
+        .on_color_trans_done = amoled_color_trans_done,
+    };
+
+    panel->color_done_cb = cb;
+    panel->color_done_ctx = user_ctx;
+    return esp_lcd_panel_io_register_event_callbacks(panel->io, &cbs, panel);
+}
+
 static esp_err_t amoled_invert_color(esp_lcd_panel_t *lcd_panel, bool invert_color_data)
 {
     amoled_panel_t *panel = __containerof(lcd_panel, amoled_panel_t, base);
@@ -378,27 +518,14 @@ void lcd_gpio_init(void)
 
   ESP_ERROR_CHECK_WITHOUT_ABORT(gpio_config(&gpio_conf)); //ESP32 onboard GPIO
 }
+// Called twice per bit read: only the direction changes, the pull-up set by lcd_gpio_init() stays
 void sda_read_mode(void)
 {
-  gpio_config_t gpio_conf = {};
-  gpio_conf.intr_type = GPIO_INTR_DISABLE;
-  gpio_conf.mode = GPIO_MODE_INPUT;
-  gpio_conf.pin_bit_mask = (bit_mask<<PIN_NUM_LCD_DATA0);
-  gpio_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-  gpio_conf.pull_up_en = GPIO_PULLUP_ENABLE;
-
-  ESP_ERROR_CHECK_WITHOUT_ABORT(gpio_config(&gpio_conf)); //ESP32 onboard GPIO
+  gpio_set_direction(PIN_NUM_LCD_DATA0, GPIO_MODE_INPUT);
 }
 void sda_write_mode(void)
 {
-  gpio_config_t gpio_conf = {};
-  gpio_conf.intr_type = GPIO_INTR_DISABLE;
-  gpio_conf.mode = GPIO_MODE_OUTPUT;
-  gpio_conf.pin_bit_mask = (bit_mask<<PIN_NUM_LCD_DATA0);
-  gpio_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-  gpio_conf.pull_up_en = GPIO_PULLUP_ENABLE;
-
-  ESP_ERROR_CHECK_WITHOUT_ABORT(gpio_config(&gpio_conf)); //ESP32 onboard GPIO
+  gpio_set_direction(PIN_NUM_LCD_DATA0, GPIO_MODE_OUTPUT);
 }
 void delay_us(uint32_t us)
 {
@@ -490,13 +617,13 @@ uint8_t SPI_ReadData_Continue(void)
 
 uint8_t read_lcd_id(void)
 {
+  // Same reset pulse as amoled_reset(): the panel is left reset, the caller does not need another one
   lcd_gpio_init();
   lcd_rst_1;
-  vTaskDelay(pdMS_TO_TICKS(120));
   lcd_rst_0;
-  vTaskDelay(pdMS_TO_TICKS(120));
+  vTaskDelay(pdMS_TO_TICKS(10));
   lcd_rst_1;
-  vTaskDelay(pdMS_TO_TICKS(120));
+  vTaskDelay(pdMS_TO_TICKS(150));
   SPI_ReadComm(0xDA);
   uint8_t ret = SPI_ReadData_Continue();
   ESP_LOGI("lcd_Model","0x%02x",ret);
@@ -9,13 +9,34 @@
 #include <stdint.h>
 
 #include "esp_lcd_panel_vendor.h"
+#include "driver/spi_master.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Reset the panel and read its controller ID (register 0xDA), bit-banging the QSPI pins
+ *
+ * @note  Call before the SPI bus is initialized. The panel is left reset, ready for its init sequence.
+ *        Slower than `esp_amoled_read_id`, kept for controllers that do not answer a read on the SPI bus.
+ * @return Controller ID, SH8601_ID or CO5300_ID
+ */
 uint8_t read_lcd_id(void);
 
+/**
+ * @brief Reset the panel and read its controller ID (register 0xDA) with a single-line SPI read
+ *
+ * @note  Call after spi_bus_initialize() and before the panel IO is created: a 3-wire half-duplex device
+ *        is added on the panel CS line for the read only. The panel is left reset, ready for its init sequence.
+ * @param[in] host SPI bus of the panel
+ * @param[out] id Controller ID, SH8601_ID or CO5300_ID
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_read_id(spi_host_device_t host, uint8_t *id);
+
 /**
  * @brief LCD panel initialization commands.
  *
@@ -57,6 +78,105 @@ typedef struct {
  */
 esp_err_t esp_amoled_new_panel(const esp_lcd_panel_io_handle_t io, const esp_lcd_panel_dev_config_t *panel_dev_config, esp_lcd_panel_handle_t *ret_panel);
 
+/**
+ * @brief Callback invoked when the color data of one draw_bitmap call has been sent
+ *
+ * @note  Called from the SPI ISR: keep it short and ISR-safe.
+ * @return Whether a higher priority task has been woken up by this function
+ */
+typedef bool (*amoled_color_done_cb_t)(esp_lcd_panel_handle_t panel, void *user_ctx);
+
+/**
+ * @brief Register the color transfer done callback of the panel
+ *
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @param[in] cb Callback, or NULL to unregister
+ * @param[in] user_ctx User data passed to the callback
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_register_color_done_cb(esp_lcd_panel_handle_t panel, amoled_color_done_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Set the window of frame memory written by the next pixels (CASET and RASET)
+ *
+ * @note  Like draw_bitmap, the end position is exclusive and the panel gap is added.
+ *        Waits for the color transfers in flight, as every command does.
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_set_window(esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end, int y_end);
+
+/**
+ * @brief Queue pixels for the current window
+ *
+ * @note  With `continue_write` the pixels follow the last ones written (memory write continue, RAMWRC),
+ *        without it they start at the top left corner of the window (RAMWR). The color done callback
+ *        is called once the pixels have been sent.
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @param[in] color_data Pixels in panel byte order, DMA-capable, untouched until the transfer is done
+ * @param[in] len Size of `color_data` in bytes
+ * @param[in] continue_write Continue the previous write instead of starting a new one
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_write_color(esp_lcd_panel_handle_t panel, const void *color_data, size_t len, bool continue_write);
+
+/**
+ * @brief Set the display brightness (WRDISBV, 0x51)
+ *
+ * @note  Waits for the color transfers in flight, as every command does, and ends the current memory write.
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @param[in] level Brightness, 0 (off) to 0xFF
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_set_brightness(esp_lcd_panel_handle_t panel, uint8_t level);
+
+/**
+ * @brief Turn idle mode on (IDMON, 0x39) or off (IDMOFF, 0x38)
+ *
+ * @note  In idle mode the panel shows 8 colors (the top bit of each component) at a lower power.
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @param[in] idle Idle mode on
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_set_idle(esp_lcd_panel_handle_t panel, bool idle);
+
+/**
+ * @brief Light only rows y_start to y_end - 1 (PTLAR, 0x30, then PTLON, 0x12), or every row again (NORON, 0x13)
+ *
+ * @note  The rows outside of the partial area are black, their memory is kept. The panel gap is added.
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @param[in] y_start First row of the partial area
+ * @param[in] y_end Row after the last one, not above y_start to go back to normal mode
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_set_partial(esp_lcd_panel_handle_t panel, int y_start, int y_end);
+
+/**
+ * @brief Enter (SLPIN, 0x10) or leave (SLPOUT, 0x11) sleep mode
+ *
+ * @note  The panel keeps its memory while asleep but takes no pixels. It needs 120 ms after a sleep out
+ *        before pixels and between two of these commands, and 5 ms after either before any command:
+ *        the caller waits, and turns the display off before and on after.
+ * @param[in] panel LCD panel handle created by `esp_amoled_new_panel`
+ * @param[in] sleep Enter sleep mode
+ * @return
+ *      - ESP_OK: Success
+ *      - Otherwise: Fail
+ */
+esp_err_t esp_amoled_panel_sleep(esp_lcd_panel_handle_t panel, bool sleep);
+
 /**
  * @brief LCD panel bus configuration structure
  *
@@ -28,7 +28,7 @@
 
 /*Color depth: 1 (I1), 8 (L8), 16 (RGB565), 24 (RGB888), 32 (XRGB8888)*/
 #define LV_COLOR_DEPTH 16
-#define LV_COLOR_16_SWAP 1
+/*LVGL 9 has no LV_COLOR_16_SWAP, the display driver swaps the bytes (AMOLED_SWAP_BYTES in board_config.h)*/
 /*=========================
    STDLIB WRAPPER SETTINGS
  *=========================*/
@@ -889,6 +889,24 @@
 /*1: Enable the runtime performance profiler*/
 #define LV_USE_PROFILER 0
 #if LV_USE_PROFILER
+    /*1: Send the profiler points to the event trace of the sketch (trace.h), it needs TRACE_EVENTS in board_config.h
+     *0: Use the built-in profiler of LVGL below*/
+    #define LV_PROFILER_TRACE_EVENTS 1
+#endif
+#if LV_USE_PROFILER && LV_PROFILER_TRACE_EVENTS
+    #define LV_USE_PROFILER_BUILTIN 0
+    #define LV_PROFILER_INCLUDE "lvgl/src/misc/lv_profiler_builtin.h"
+    #if !defined(__ASSEMBLY__)
+        #ifdef __cplusplus
+        extern "C"
+        #endif
+        void trace_event(char type, const char *name); /*trace.c, the name is kept as a pointer*/
+    #endif
+    #define LV_PROFILER_BEGIN    trace_event('B', __func__)
+    #define LV_PROFILER_END      trace_event('E', __func__)
+    #define LV_PROFILER_BEGIN_TAG(tag) trace_event('B', tag)
+    #define LV_PROFILER_END_TAG(tag)   trace_event('E', tag)
+#elif LV_USE_PROFILER
     /*1: Enable the built-in profiler*/
     #define LV_USE_PROFILER_BUILTIN 1
     #if LV_USE_PROFILER_BUILTIN
@@ -421,9 +421,15 @@ void qmi8658_config_gyro(enum qmi8658_GyrRange range, enum qmi8658_GyrOdr odr, e
 
 
 void qmi8658_send_ctl9cmd(enum qmi8658_Ctrl9Command cmd)
+{
+	qmi8658_ctrl9_cmd(cmd, 100);
+}
+
+unsigned char qmi8658_ctrl9_cmd(enum qmi8658_Ctrl9Command cmd, unsigned int timeout_ms)
 {
 	unsigned char	status1 = 0x00;
-	unsigned short count=0;
+	unsigned int count=0;
+	unsigned char done;
 
 	qmi8658_write_reg(Qmi8658Register_Ctrl9, (unsigned char)cmd);	// write commond to ctrl9
 #if 1 //defined(QMI8658_NEW_FIRMWARE)
@@ -433,11 +439,12 @@ void qmi8658_send_ctl9cmd(enum qmi8658_Ctrl9Command cmd)
 	//unsigned char cmd_done = 0x01;
 
 	qmi8658_read_reg(status_reg, &status1, 1);
-	while(((status1&cmd_done)!=cmd_done)&&(count++<100))		// read statusINT until bit7 is 1
+	while(((status1&cmd_done)!=cmd_done)&&(count++<timeout_ms))		// read statusINT until bit7 is 1
 	{
 		qmi8658_delay(1);
 		qmi8658_read_reg(status_reg, &status1, 1);
 	}
+	done = (status1&cmd_done) == cmd_done;
 	//qmi8658_log("ctrl9 cmd done1 count=%d\n",count);
 
 	qmi8658_write_reg(Qmi8658Register_Ctrl9, qmi8658_Ctrl9_Cmd_NOP);	// write commond  0x00 to ctrl9
@@ -450,13 +457,26 @@ void qmi8658_send_ctl9cmd(enum qmi8658_Ctrl9Command cmd)
 	}
 	//qmi8658_log("ctrl9 cmd done2 count=%d\n",count);
 #else
-	while(((status1&QMI8658_STATUS1_CMD_DONE)==0)&&(count++<100))
+	while(((status1&QMI8658_STATUS1_CMD_DONE)==0)&&(count++<timeout_ms))
 	{
 		qmi8658_delay(1);
 		qmi8658_read_reg(Qmi8658Register_Status1, &status1, sizeof(status1));
 	}
+	done = (status1&QMI8658_STATUS1_CMD_DONE) != 0;
 #endif
+	return done;
+}
+
+unsigned char qmi8658_wait_data_ready(unsigned int timeout_ms)
+{
+	unsigned int count = 0;
 
+	// Accelerometer or gyroscope data available, as qmi8658_read_xyz() checks
+	while(((qmi8658_readStatus0()&0x03)==0)&&(count++<timeout_ms))
+	{
+		qmi8658_delay(1);
+	}
+	return count <= timeout_ms;
 }
 
 unsigned char qmi8658_readStatusInt(void)
@@ -642,11 +662,11 @@ void qmi8658_on_demand_cali(void)
 	qmi8658_log("qmi8658_on_demand_cali start\n");
 	qmi8658_write_reg(Qmi8658Register_Reset, 0xb0);
 	qmi8658_delay(10);	// delay
-	qmi8658_write_reg(Qmi8658Register_Ctrl9, (unsigned char)qmi8658_Ctrl9_Cmd_On_Demand_Cali);
-	qmi8658_delay(2200);	// delay 2000ms above
-	qmi8658_write_reg(Qmi8658Register_Ctrl9, (unsigned char)qmi8658_Ctrl9_Cmd_NOP);
-	qmi8658_delay(100);	// delay
-	qmi8658_log("qmi8658_on_demand_cali done\n");
+	// The calibration takes about 1.5 s: poll the command done bit instead of sleeping for the worst case
+	if(!qmi8658_ctrl9_cmd(qmi8658_Ctrl9_Cmd_On_Demand_Cali, QMI8658_CALI_TIMEOUT_MS))
+		qmi8658_log("qmi8658_on_demand_cali timeout\n");
+	else
+		qmi8658_log("qmi8658_on_demand_cali done\n");
 }
 
 void qmi8658_config_reg(unsigned char low_power)
@@ -38,6 +38,7 @@
 #define QMI8658_FIFO_MAP_INT2			~0x04	// ctrl1
 
 #define qmi8658_log		printf
+#define QMI8658_CALI_TIMEOUT_MS		3000	// on-demand calibration at qmi8658_init(), done in about 1.5 s
 
 enum Qmi8658Register
 {
@@ -363,6 +364,8 @@ extern void qmi8658_config_fifo(unsigned char watermark,enum qmi8658_FifoSize si
 extern unsigned short qmi8658_read_fifo(unsigned char* data);
 #endif
 extern void qmi8658_send_ctl9cmd(enum qmi8658_Ctrl9Command cmd);
+extern unsigned char qmi8658_ctrl9_cmd(enum qmi8658_Ctrl9Command cmd, unsigned int timeout_ms);
+extern unsigned char qmi8658_wait_data_ready(unsigned int timeout_ms);
 
 /*qmi8658c-example*/
 void qmi8658c_example(void* parmeter);
@@ -0,0 +1,487 @@
+// Host tool: bakes the scale and the placement of an image widget into its image, at build time
+//
+// Build from the sketch folder:
+//   g++ -std=gnu++17 -O2 -I. tools/asset_bake.cpp -o asset_bake
+//
+//   ./asset_bake ui_img_surface_level_png.c ui_Screen1.c
+// is the build step run after each SquareLine Studio export: the image widget of the screen that shows
+// ui_img_surface_level_png, centered with an offset and an lv_image_set_scale(), is read from the screen
+// source. The image is scaled once here, cropped to the screen, and written to a source of its own,
+// ui_img_surface_level_baked.c (or -o out.c), as ui_img_surface_level_baked. The screen source is then
+// pointed at it, unscaled, at the top left corner of the area it covers: LVGL only copies it, and
+// nothing references the exported image any more, so the linker leaves it out. The image export itself
+// is never touched; a screen that shows a baked image already is left alone, export it again first.
+//
+// The pixels outside the round panel are never seen: they are made opaque. When every visible pixel is
+// opaque the image is written as plain RGB565, without its alpha plane; otherwise --bg RRGGBB flattens the
+// translucent pixels on the color of what lies below (the screen background), or the alpha plane is kept.
+// The flash the image takes and the time to draw it the LVGL way (scaled, blended) and baked (copied)
+// are printed, the times measured on this host: the board's are printed by RENDER_BENCH in the sketch.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "amoled_round.h"
+
+#define BAKED_MARK "// Baked by tools/asset_bake.cpp"
+
+struct Image
+{
+  std::string name; // of the lv_image_dsc_t
+  int w = 0, h = 0;
+  bool alpha = false;         // RGB565A8: the RGB565 plane, then the alpha plane
+  std::vector<uint16_t> rgb;  // RGB565, LVGL order
+  std::vector<uint8_t> a;     // 255 everywhere without alpha
+};
+
+static bool read_file(const char *path, std::string &s)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    s.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static int header_field(const std::string &s, const char *field)
+{
+  const size_t p = s.find(field);
+  return p == std::string::npos ? -1 : atoi(s.c_str() + p + strlen(field));
+}
+
+// An image source as SquareLine Studio and LVGL's converter write them: one byte array and its descriptor
+static bool parse(const std::string &s, Image &img, std::string &err)
+{
+  const size_t data = s.find("_data[] = {");
+  const size_t dsc = s.find("const lv_image_dsc_t ");
+  if (data == std::string::npos || dsc == std::string::npos)
+  {
+    err = "no image data or descriptor";
+    return false;
+  }
+  const size_t name = dsc + strlen("const lv_image_dsc_t ");
+  img.name = s.substr(name, s.find_first_of(" =", name) - name);
+  img.w = header_field(s, ".header.w = ");
+  img.h = header_field(s, ".header.h = ");
+  const size_t cf = s.find(".header.cf = ");
+  if (img.w <= 0 || img.h <= 0 || cf == std::string::npos)
+  {
+    err = "no size or color format in the descriptor";
+    return false;
+  }
+  const std::string format = s.substr(cf + 13, s.find_first_of(",\n", cf) - cf - 13);
+  if (format == "LV_COLOR_FORMAT_NATIVE_WITH_ALPHA" || format == "LV_COLOR_FORMAT_RGB565A8")
+    img.alpha = true;
+  else if (format != "LV_COLOR_FORMAT_NATIVE" && format != "LV_COLOR_FORMAT_RGB565")
+  {
+    err = "color format " + format + " (RGB565 or RGB565A8 only, LV_COLOR_DEPTH 16)";
+    return false;
+  }
+  std::vector<uint8_t> bytes;
+  const size_t end = s.find("};", data);
+  for (size_t p = s.find("0x", data); p < end; p = s.find("0x", p + 2))
+    bytes.push_back((uint8_t)strtoul(s.c_str() + p + 2, NULL, 16));
+  const size_t n = (size_t)img.w * img.h;
+  if (bytes.size() != n * (img.alpha ? 3 : 2))
+  {
+    err = "data size does not match the descriptor";
+    return false;
+  }
+  img.rgb.resize(n);
+  img.a.assign(n, 255);
+  for (size_t i = 0; i < n; i++)
+  {
+    img.rgb[i] = (uint16_t)(bytes[2 * i] | bytes[2 * i + 1] << 8);
+    if (img.alpha)
+      img.a[i] = bytes[2 * n + i];
+  }
+  return true;
+}
+
+// Where LVGL draws an lv_image centered on the screen with an offset, scaled around its center (its
+// default pivot): the center of screen pixel x is at source column sx(x), in 1/256 pixels
+struct Placement
+{
+  int scale;  // 256: 1x
+  int px, py; // pivot on the screen
+  int x1, y1, x2, y2; // screen area covered by the scaled image, inclusive, cropped to the screen
+  int sx(int x, const Image &img) const { return ((x - px) * 256 + 128) * 256 / scale + img.w / 2 * 256; }
+  int sy(int y, const Image &img) const { return ((y - py) * 256 + 128) * 256 / scale + img.h / 2 * 256; }
+};
+
+static Placement place(const Image &img, int scale, int ofs_x, int ofs_y)
+{
+  Placement p;
+  p.scale = scale;
+  const int obj_x = (DISPLAY_WIDTH - img.w) / 2 + ofs_x, obj_y = (DISPLAY_HEIGHT - img.h) / 2 + ofs_y;
+  p.px = obj_x + img.w / 2;
+  p.py = obj_y + img.h / 2;
+  p.x1 = std::max(0, p.px - (img.w / 2 * scale + 255) / 256);
+  p.y1 = std::max(0, p.py - (img.h / 2 * scale + 255) / 256);
+  p.x2 = std::min(DISPLAY_WIDTH - 1, p.px + ((img.w - img.w / 2) * scale - 1) / 256);
+  p.y2 = std::min(DISPLAY_HEIGHT - 1, p.py + ((img.h - img.h / 2) * scale - 1) / 256);
+  return p;
+}
+
+static inline uint16_t mix565(uint16_t a, uint16_t b, int wb) // wb / 256 of b
+{
+  const int wa = 256 - wb;
+  const int r = (((a >> 11) & 0x1F) * wa + ((b >> 11) & 0x1F) * wb) >> 8;
+  const int g = (((a >> 5) & 0x3F) * wa + ((b >> 5) & 0x3F) * wb) >> 8;
+  const int bl = ((a & 0x1F) * wa + (b & 0x1F) * wb) >> 8;
+  return (uint16_t)(r << 11 | g << 5 | bl);
+}
+
+// One screen pixel of the scaled image, bilinear like LVGL's anti-aliased transform; false outside of it
+static bool sample(const Image &img, int ux, int uy, uint16_t &c, uint8_t &a)
+{
+  ux -= 128; // between the centers of the source pixels
+  uy -= 128;
+  const int x0 = ux >> 8, y0 = uy >> 8, fx = ux & 0xFF, fy = uy & 0xFF;
+  if (x0 < -1 || y0 < -1 || x0 >= img.w || y0 >= img.h)
+    return false;
+  auto at = [&](int x, int y, uint16_t &pc) -> int
+  {
+    x = x < 0 ? 0 : x >= img.w ? img.w - 1 : x;
+    y = y < 0 ? 0 : y >= img.h ? img.h - 1 : y;
+    pc = img.rgb[y * img.w + x];
+    return img.a[y * img.w + x];
+  };
+  uint16_t c00, c10, c01, c11;
+  const int a00 = at(x0, y0, c00), a10 = at(x0 + 1, y0, c10), a01 = at(x0, y0 + 1, c01), a11 = at(x0 + 1, y0 + 1, c11);
+  c = mix565(mix565(c00, c10, fx), mix565(c01, c11, fx), fy);
+  const int top = (a00 * (256 - fx) + a10 * fx) >> 8, bottom = (a01 * (256 - fx) + a11 * fx) >> 8;
+  a = (uint8_t)((top * (256 - fy) + bottom * fy) >> 8);
+  return true;
+}
+
+static uint16_t rgb888_to_565(uint32_t c)
+{
+  return (uint16_t)(((c >> 19) & 0x1F) << 11 | ((c >> 10) & 0x3F) << 5 | ((c >> 3) & 0x1F));
+}
+
+static bool visible(int x, int y)
+{
+  return x >= round_spans.row[y].x0 && x <= round_spans.row[y].x1;
+}
+
+// What LVGL does on every redraw of the area, the screen background below: scale, blend
+static void draw_scaled(const Image &img, const Placement &p, uint16_t bg, uint16_t *screen, int x1, int y1, int x2,
+                        int y2)
+{
+  for (int y = y1; y <= y2; y++)
+    for (int x = x1; x <= x2; x++)
+    {
+      uint16_t c;
+      uint8_t a;
+      uint16_t &d = screen[y * DISPLAY_WIDTH + x];
+      d = bg;
+      if (sample(img, p.sx(x, img), p.sy(y, img), c, a))
+        d = a == 255 ? c : mix565(d, c, a);
+    }
+}
+
+// And with the baked image: a copy
+static void draw_baked(const Image &baked, int bx, int by, uint16_t *screen, int x1, int y1, int x2, int y2)
+{
+  for (int y = y1; y <= y2; y++)
+    memcpy(screen + y * DISPLAY_WIDTH + x1, &baked.rgb[(y - by) * baked.w + x1 - bx], (x2 - x1 + 1) * 2);
+}
+
+template <typename F> static double time_us(F f)
+{
+  const int runs = 20;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++)
+    f();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / runs;
+}
+
+// A call on the widget in the screen source, "    lv_obj_set_x(ui_Image3, 3);": where its line starts
+// and ends, and its last argument
+struct Call
+{
+  size_t begin = std::string::npos, end = 0;
+  std::string arg;
+};
+
+static Call find_call(const std::string &s, size_t from, size_t to, const std::string &fn, const std::string &widget)
+{
+  Call c;
+  const size_t p = s.find(fn + "(" + widget + ", ", from);
+  if (p == std::string::npos || p >= to)
+    return c;
+  c.begin = s.rfind('\n', p) + 1;
+  c.end = s.find('\n', p) + 1;
+  const size_t a = p + fn.size() + widget.size() + 3;
+  c.arg = s.substr(a, s.find(')', a) - a);
+  return c;
+}
+
+// The image widget of the screen that shows image: its name, where its calls are, and where and how
+// big LVGL draws it
+struct Widget
+{
+  std::string name;
+  size_t block_begin = 0, block_end = 0; // its calls, up to the blank line after them
+  Call src, x, y, align, scale;
+  int ofs_x = 0, ofs_y = 0, zoom = 256;
+};
+
+static bool find_widget(const std::string &screen, const std::string &image, Widget &w, std::string &err)
+{
+  const size_t ref = screen.find("&" + image + ")");
+  const size_t call = screen.rfind("lv_image_set_src(", ref);
+  if (ref == std::string::npos || call == std::string::npos)
+  {
+    err = "no image widget shows " + image;
+    return false;
+  }
+  const size_t name = call + strlen("lv_image_set_src(");
+  w.name = screen.substr(name, screen.find(',', name) - name);
+  w.block_begin = screen.rfind('\n', call) + 1;
+  w.block_end = screen.find("\n\n", call);
+  w.block_end = w.block_end == std::string::npos ? screen.size() : w.block_end + 1;
+  w.src = find_call(screen, w.block_begin, w.block_end, "lv_image_set_src", w.name);
+  w.x = find_call(screen, w.block_begin, w.block_end, "lv_obj_set_x", w.name);
+  w.y = find_call(screen, w.block_begin, w.block_end, "lv_obj_set_y", w.name);
+  w.align = find_call(screen, w.block_begin, w.block_end, "lv_obj_set_align", w.name);
+  w.scale = find_call(screen, w.block_begin, w.block_end, "lv_image_set_scale", w.name);
+  if (w.align.arg != "LV_ALIGN_CENTER")
+  {
+    err = w.name + " is not aligned with LV_ALIGN_CENTER";
+    return false;
+  }
+  w.ofs_x = w.x.arg.empty() ? 0 : atoi(w.x.arg.c_str());
+  w.ofs_y = w.y.arg.empty() ? 0 : atoi(w.y.arg.c_str());
+  w.zoom = w.scale.arg.empty() ? 256 : atoi(w.scale.arg.c_str());
+  return true;
+}
+
+// The screen source with the widget showing the baked image, unscaled at x,y
+static std::string point_screen(const std::string &screen, const Widget &w, const std::string &baked, int x, int y)
+{
+  const std::string indent = screen.substr(w.src.begin, screen.find_first_not_of(' ', w.src.begin) - w.src.begin);
+  std::string block;
+  block += indent + "lv_image_set_src(" + w.name + ", &" + baked + ");\n";
+  for (size_t p = w.block_begin; p < w.block_end;)
+  {
+    const size_t eol = screen.find('\n', p) + 1;
+    if (p == w.src.begin || p == w.x.begin || p == w.y.begin || p == w.scale.begin)
+      ; // rewritten or dropped
+    else if (p == w.align.begin)
+    {
+      block += indent + "lv_obj_set_x(" + w.name + ", " + std::to_string(x) + ");\n";
+      block += indent + "lv_obj_set_y(" + w.name + ", " + std::to_string(y) + ");\n";
+      block += indent + "lv_obj_set_align(" + w.name + ", LV_ALIGN_TOP_LEFT);\n";
+    }
+    else
+      block += screen.substr(p, eol - p);
+    p = eol;
+  }
+  std::string out = screen.substr(0, w.block_begin) + block + screen.substr(w.block_end);
+  const size_t inc = out.find("#include \"ui.h\"\n");
+  if (inc != std::string::npos)
+    out.insert(inc + strlen("#include \"ui.h\"\n"),
+               "\n" BAKED_MARK ": " + w.name + " shows " + baked + "\nLV_IMAGE_DECLARE(" + baked + ");\n");
+  return out;
+}
+
+static bool write_text(const char *path, const std::string &s)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  const bool ok = fwrite(s.data(), 1, s.size(), f) == s.size();
+  return fclose(f) == 0 && ok;
+}
+
+static bool write_source(const char *path, const Image &img, const char *from, const char *note)
+{
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+  fprintf(f, "%s from %s, do not edit: run it again after each export\n", BAKED_MARK, from);
+  fprintf(f, "// %s\n\n", note);
+  fprintf(f, "#include \"ui.h\"\n\n#ifndef LV_ATTRIBUTE_MEM_ALIGN\n    #define LV_ATTRIBUTE_MEM_ALIGN\n#endif\n\n");
+  fprintf(f, "const LV_ATTRIBUTE_MEM_ALIGN uint8_t %s_data[] = {\n", img.name.c_str());
+  std::vector<uint8_t> bytes;
+  for (uint16_t c : img.rgb)
+  {
+    bytes.push_back((uint8_t)c);
+    bytes.push_back((uint8_t)(c >> 8));
+  }
+  if (img.alpha)
+    bytes.insert(bytes.end(), img.a.begin(), img.a.end());
+  for (size_t i = 0; i < bytes.size(); i++)
+    fprintf(f, "%s0x%02X,%s", i % 128 ? "" : "    ", bytes[i], (i % 128 == 127 || i + 1 == bytes.size()) ? "\n" : "");
+  fprintf(f, "};\nconst lv_image_dsc_t %s = {\n", img.name.c_str());
+  fprintf(f, "    .header.w = %d,\n    .header.h = %d,\n", img.w, img.h);
+  fprintf(f, "    .data_size = sizeof(%s_data),\n", img.name.c_str());
+  fprintf(f, "    .header.cf = %s,\n", img.alpha ? "LV_COLOR_FORMAT_RGB565A8" : "LV_COLOR_FORMAT_RGB565");
+  fprintf(f, "    .header.magic = LV_IMAGE_HEADER_MAGIC,\n    .data = %s_data\n};\n\n", img.name.c_str());
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const char *in = NULL, *screen_path = NULL, *out = NULL;
+  long bg = -1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      out = argv[++i];
+    else if (!strcmp(argv[i], "--bg") && i + 1 < argc)
+      bg = strtol(argv[++i], NULL, 16);
+    else if (!in)
+      in = argv[i];
+    else if (!screen_path)
+      screen_path = argv[i];
+  }
+  if (!in || !screen_path)
+  {
+    fprintf(stderr, "usage: %s image.c screen.c [--bg RRGGBB] [-o out.c]\n"
+                    "  screen.c shows the image in an LV_ALIGN_CENTER widget, it is pointed at the baked one\n"
+                    "  out.c is <name>_baked.c by default, <name> the image's without its _png\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::string src, screen_src, err;
+  if (!read_file(in, src))
+  {
+    perror(in);
+    return 1;
+  }
+  if (!read_file(screen_path, screen_src))
+  {
+    perror(screen_path);
+    return 1;
+  }
+  if (screen_src.find(BAKED_MARK) != std::string::npos)
+  {
+    printf("%s shows a baked image already, export it again to bake it with other settings\n", screen_path);
+    return 0;
+  }
+  if (src.find(BAKED_MARK) != std::string::npos)
+  {
+    fprintf(stderr, "%s is baked already, bake the exported image instead\n", in);
+    return 1;
+  }
+  Image img;
+  if (!parse(src, img, err))
+  {
+    fprintf(stderr, "%s: %s\n", in, err.c_str());
+    return 1;
+  }
+  Widget widget;
+  if (!find_widget(screen_src, img.name, widget, err) || widget.zoom <= 0)
+  {
+    fprintf(stderr, "%s: %s\n", screen_path, err.empty() ? "bad scale" : err.c_str());
+    return 1;
+  }
+  const Placement p = place(img, widget.zoom, widget.ofs_x, widget.ofs_y);
+  if (p.x1 > p.x2 || p.y1 > p.y2)
+  {
+    fprintf(stderr, "%s: the image is off the screen\n", in);
+    return 1;
+  }
+
+  // The screen area the image covers, sampled once
+  Image baked;
+  baked.name = img.name;
+  if (baked.name.size() > 4 && baked.name.compare(baked.name.size() - 4, 4, "_png") == 0)
+    baked.name.resize(baked.name.size() - 4);
+  baked.name += "_baked";
+  const std::string out_path = out ? out : baked.name + ".c";
+  if (out_path == in)
+  {
+    fprintf(stderr, "%s: the export is never overwritten, write the baked image to another file\n", in);
+    return 1;
+  }
+  baked.w = p.x2 - p.x1 + 1;
+  baked.h = p.y2 - p.y1 + 1;
+  baked.rgb.resize((size_t)baked.w * baked.h);
+  baked.a.resize(baked.rgb.size());
+  const uint16_t flat = rgb888_to_565(bg < 0 ? 0 : (uint32_t)bg);
+  long translucent = 0, hidden = 0;
+  for (int y = p.y1; y <= p.y2; y++)
+    for (int x = p.x1; x <= p.x2; x++)
+    {
+      const size_t i = (size_t)(y - p.y1) * baked.w + (x - p.x1);
+      uint16_t c = flat;
+      uint8_t a = 0;
+      sample(img, p.sx(x, img), p.sy(y, img), c, a);
+      if (a < 255 && !visible(x, y))
+      {
+        c = mix565(flat, c, a); // nobody sees it, made opaque
+        a = 255;
+        hidden++;
+      }
+      else if (a < 255)
+        translucent++;
+      baked.rgb[i] = c;
+      baked.a[i] = a;
+    }
+  if (translucent && bg >= 0)
+  {
+    for (size_t i = 0; i < baked.rgb.size(); i++)
+      if (baked.a[i] < 255)
+        baked.rgb[i] = mix565(flat, baked.rgb[i], baked.a[i]);
+    baked.a.assign(baked.a.size(), 255);
+  }
+  baked.alpha = translucent && bg < 0;
+
+  // What the image costs before and after, for a full redraw and for the bubble moving over it
+  std::vector<uint16_t> screen((size_t)DISPLAY_WIDTH * DISPLAY_HEIGHT);
+  const uint16_t scr_bg = bg < 0 ? 0 : flat;
+  const int bx = DISPLAY_WIDTH / 2 - 32, by = DISPLAY_HEIGHT / 2 - 32; // 64 x 64, the bubble and its old place
+  const double full_before = time_us([&] { draw_scaled(img, p, scr_bg, screen.data(), p.x1, p.y1, p.x2, p.y2); });
+  const double bubble_before = time_us([&] { draw_scaled(img, p, scr_bg, screen.data(), bx, by, bx + 63, by + 63); });
+  double full_after = 0, bubble_after = 0;
+  if (!baked.alpha)
+  {
+    full_after = time_us([&] { draw_baked(baked, p.x1, p.y1, screen.data(), p.x1, p.y1, p.x2, p.y2); });
+    bubble_after = time_us([&] { draw_baked(baked, p.x1, p.y1, screen.data(), bx, by, bx + 63, by + 63); });
+  }
+
+  char note[160];
+  snprintf(note, sizeof(note), "scale %d, centered at %+d,%+d, %dx%d at %d,%d, %s", widget.zoom, widget.ofs_x,
+           widget.ofs_y, baked.w, baked.h, p.x1, p.y1, baked.alpha ? "RGB565A8" : "RGB565");
+  if (!write_source(out_path.c_str(), baked, in, note))
+  {
+    perror(out_path.c_str());
+    return 1;
+  }
+  if (!write_text(screen_path, point_screen(screen_src, widget, baked.name, p.x1, p.y1)))
+  {
+    perror(screen_path);
+    return 1;
+  }
+
+  const size_t before = img.rgb.size() * (img.alpha ? 3 : 2), after = baked.rgb.size() * (baked.alpha ? 3 : 2);
+  printf("%s: %dx%d %s -> %s: %s\n", img.name.c_str(), img.w, img.h, img.alpha ? "RGB565A8" : "RGB565",
+         baked.name.c_str(), note);
+  printf("  %s shows it unscaled at %d,%d (LV_ALIGN_TOP_LEFT)\n", widget.name.c_str(), p.x1, p.y1);
+  printf("  %ld hidden pixels made opaque, %ld visible ones translucent%s\n", hidden, translucent,
+         translucent ? (bg >= 0 ? ", flattened on the background" : ", the alpha plane is kept") : "");
+  printf("  flash: %zu -> %zu bytes (%+.1f%%)\n", before, after, 100.0 * ((double)after - before) / before);
+  printf("  pixels drawn on a full redraw: %d, scaled and blended -> %s\n", baked.w * baked.h,
+         baked.alpha ? "blended" : "copied");
+  if (!baked.alpha)
+    printf("  time on this host, scaled and blended -> copied: full screen %.0f -> %.0f us (%.0fx), "
+           "64x64 bubble area %.1f -> %.1f us (%.0fx)\n",
+           full_before, full_after, full_before / full_after, bubble_before, bubble_after,
+           bubble_before / bubble_after);
+  printf("  written to %s, %s points at it\n", out_path.c_str(), screen_path);
+  return 0;
+}
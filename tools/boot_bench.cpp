@@ -0,0 +1,73 @@
+// Host benchmark: time to the first frame, and what the controller ID read costs in it
+//
+// Build and run from the sketch folder:
+//   gcc -c -std=gnu11 -I. -Itools/host low_level_amoled.c -o low_level_amoled.o &&
+//   g++ -std=gnu++17 -O2 -I. -Itools -Itools/host tools/boot_bench.cpp tools/host/emu_panel.cpp amoled.cpp
+//       low_level_amoled.o -o boot_bench && ./boot_bench
+// Add -DCONTROLLER_ID_READ_GPIO=0 to both lines for the ID read through the SPI peripheral, or
+// -DAMOLED_CONTROLLER=SH8601_ID or CO5300_ID for a driver that does not read it.
+//
+// For each controller, the boot is timed in emulated time (delays included) from begin() to the last
+// pixel of a first full black frame. It must drive the right controller and read the ID once, never
+// when the driver is built for one controller.
+//
+#include <stdio.h>
+#include "amoled.h"
+#include "emu_panel.h"
+
+struct Boot
+{
+  double begin_ms, frame_ms;
+  double id_read_us;
+  long id_reads;
+};
+
+static bool boot(uint8_t id, Boot &b)
+{
+  emu_reset(id);
+  const int64_t t0 = emu_time_us();
+  Amoled amoled;
+  if (!amoled.begin() || amoled.ID() != id)
+    return false;
+  b.begin_ms = (emu_time_us() - t0) / 1000.0;
+  if (!amoled.fillScreen(AMOLED_COLOR_BLACK))
+    return false;
+  emu_complete_all();
+  b.frame_ms = (emu_time_us() - t0) / 1000.0;
+  b.id_reads = emu_counters().id_reads;
+  b.id_read_us = emu_counters().id_read_us;
+  return true;
+}
+
+static bool run(uint8_t id, const char *name)
+{
+  Boot b;
+  if (!boot(id, b))
+  {
+    printf("%-8s boot failed\n", name);
+    return false;
+  }
+  printf("%-8s %10.1f %16.1f %9ld %11.1f\n", name, b.begin_ms, b.frame_ms, b.id_reads, b.id_read_us);
+  if (b.id_reads != (AMOLED_CONTROLLER ? 0 : 1))
+  {
+    printf("  the ID was read when it should not have been, or the other way round\n");
+    return false;
+  }
+  return true;
+}
+
+int main()
+{
+  printf("%-8s %10s %16s %9s %11s\n", "", "begin ms", "first frame ms", "ID reads", "ID read us");
+#if AMOLED_CONTROLLER
+  const bool ok = run(AMOLED_CONTROLLER, AmoledController<AMOLED_CONTROLLER>::name);
+#else
+  const bool ok = run(SH8601_ID, SH8601_NAME) && run(CO5300_ID, CO5300_NAME);
+#endif
+  if (!ok)
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Host benchmark: panel windows and bytes per frame with and without dirty-area coalescing
+//
+// Build and run from the sketch folder:
+//   g++ -std=c++14 -O2 -I. tools/coalesce_bench.cpp -o coalesce_bench && ./coalesce_bench
+//
+// Each frame is a list of even-aligned areas as the rounder leaves them. They are flushed as they
+// come, after LVGL's own join (two areas are joined when their bounding box is smaller than their
+// summed sizes), and grown by coalesce_add() as they are invalidated, before that join, the way the
+// sketch does it. Windows and pixel bytes follow Amoled::drawArea
+// (STRIP_SIZE strips clipped to the round panel), cost adds WINDOW_OVERHEAD_BYTES per window.
+// Every pixel of the input areas is checked to be covered by the merged ones.
+//
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "amoled_coalesce.h"
+
+typedef struct
+{
+  long windows;
+  long pixel_bytes;
+} Traffic;
+
+static Traffic traffic(const CoalesceRect *r, int n)
+{
+  Traffic t = {0, 0};
+  for (int i = 0; i < n; i++)
+  {
+    const int w = r[i].x2 - r[i].x1 + 1, h = r[i].y2 - r[i].y1 + 1;
+    const int push_w = even_width(w);
+    const int rows = strip_rows(push_w, STRIP_SIZE);
+    for (int row = 0; row < h; row += rows)
+    {
+      const int push_h = even_width((h - row < rows) ? h - row : rows);
+      int xa = r[i].x1, xb = r[i].x1 + push_w;
+      if (!round_clip(r[i].y1 + row, push_h, xa, xb))
+        continue;
+      t.windows++;
+      t.pixel_bytes += (long)(xb - xa) * push_h * 2;
+    }
+  }
+  return t;
+}
+
+// What lv_refr_join_area() does in LVGL 9
+static int lvgl_join(CoalesceRect *r, int n)
+{
+  for (bool joined = true; joined;)
+  {
+    joined = false;
+    for (int i = 0; i < n && !joined; i++)
+      for (int j = 0; j < n && !joined; j++)
+      {
+        if (i == j)
+          continue;
+        const CoalesceRect u = coalesce_union(r[i], r[j]);
+        const long size = (long)(u.x2 - u.x1 + 1) * (u.y2 - u.y1 + 1);
+        const long si = (long)(r[i].x2 - r[i].x1 + 1) * (r[i].y2 - r[i].y1 + 1);
+        const long sj = (long)(r[j].x2 - r[j].x1 + 1) * (r[j].y2 - r[j].y1 + 1);
+        const bool touch = r[i].x1 <= r[j].x2 + 1 && r[j].x1 <= r[i].x2 + 1 && r[i].y1 <= r[j].y2 + 1 && r[j].y1 <= r[i].y2 + 1;
+        if (touch && size < si + sj)
+        {
+          r[i] = u;
+          r[j] = r[--n];
+          joined = true;
+        }
+      }
+  }
+  return n;
+}
+
+// What lv_inv_area() does in LVGL 9: an area inside one saved already is dropped
+static int lvgl_invalidate(CoalesceRect *r, int n, const CoalesceRect &a)
+{
+  for (int i = 0; i < n; i++)
+    if (a.x1 >= r[i].x1 && a.y1 >= r[i].y1 && a.x2 <= r[i].x2 && a.y2 <= r[i].y2)
+      return n;
+  r[n] = a;
+  return n + 1;
+}
+
+static bool covers(const CoalesceRect *in, int n, const CoalesceRect *out, int m)
+{
+  for (int i = 0; i < n; i++)
+    for (int y = in[i].y1; y <= in[i].y2; y++)
+      for (int x = in[i].x1; x <= in[i].x2; x++)
+      {
+        bool hit = false;
+        for (int k = 0; k < m && !hit; k++)
+          hit = x >= out[k].x1 && x <= out[k].x2 && y >= out[k].y1 && y <= out[k].y2;
+        if (!hit)
+          return false;
+      }
+  return true;
+}
+
+static CoalesceRect area(int x, int y, int w, int h)
+{
+  CoalesceRect r = {x & ~1, y & ~1, (x + w - 1) | 1, (y + h - 1) | 1};
+  return r;
+}
+
+int main()
+{
+  const int cx = DISPLAY_WIDTH / 2, cy = DISPLAY_HEIGHT / 2;
+  const struct
+  {
+    const char *name;
+    int n;
+    CoalesceRect r[6];
+  } frames[] = {
+      {"bubble moves 3 px (old + new rect)", 2, {area(200, 150, 50, 50), area(203, 152, 50, 50)}},
+      {"bubble moves + both angle labels", 4,
+       {area(200, 150, 50, 50), area(203, 152, 50, 50), area(cx - 59 - 30, cy + 155 - 12, 60, 24), area(cx + 69 - 30, cy + 155 - 12, 60, 24)}},
+      {"both angle labels only", 2, {area(cx - 59 - 30, cy + 155 - 12, 60, 24), area(cx + 69 - 30, cy + 155 - 12, 60, 24)}},
+      {"target toggles + bubble near centre", 4,
+       {area(cx - 40, cy - 40, 80, 80), area(cx - 40, cy - 40, 80, 80), area(cx - 20, cy - 25, 50, 50), area(cx - 17, cy - 22, 50, 50)}},
+      {"labels far apart (top and bottom)", 2, {area(cx - 60, 60, 120, 30), area(cx - 60, 380, 120, 30)}},
+      {"adjacent rows of a list", 3, {area(100, 200, 266, 20), area(100, 220, 266, 20), area(100, 240, 266, 20)}},
+  };
+
+  printf("Strip size %d bytes, window overhead %d bytes\n\n", STRIP_SIZE, WINDOW_OVERHEAD_BYTES);
+  printf("%-38s %-14s %5s %8s %8s %10s\n", "frame", "policy", "areas", "windows", "bytes", "cost");
+  for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++)
+  {
+    for (int policy = 0; policy < 3; policy++)
+    {
+      CoalesceRect r[6];
+      int n = 0;
+      double us = 0;
+      if (policy == 0)
+      {
+        memcpy(r, frames[f].r, sizeof(r));
+        n = frames[f].n;
+      }
+      CoalesceRect seen[COALESCE_MAX_AREAS];
+      int seen_n = 0;
+      for (int i = 0; i < frames[f].n && policy >= 1; i++)
+      {
+        CoalesceRect a = frames[f].r[i];
+        if (policy == 2)
+        {
+          auto t0 = std::chrono::steady_clock::now();
+          seen_n = coalesce_add(seen, seen_n, a);
+          auto t1 = std::chrono::steady_clock::now();
+          us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        }
+        n = lvgl_invalidate(r, n, a);
+      }
+      if (policy >= 1)
+        n = lvgl_join(r, n);
+      if (!covers(frames[f].r, frames[f].n, r, n))
+      {
+        printf("%s: merged areas do not cover the input\n", frames[f].name);
+        return 1;
+      }
+      const Traffic t = traffic(r, n);
+      const char *names[] = {"as invalidated", "LVGL join", "coalesced"};
+      printf("%-38s %-14s %5d %8ld %8ld %10ld", policy ? "" : frames[f].name, names[policy], n, t.windows,
+             t.pixel_bytes, t.pixel_bytes + t.windows * (long)WINDOW_OVERHEAD_BYTES);
+      if (policy == 2)
+        printf("  (%.1f us on the host)", us);
+      printf("\n");
+    }
+  }
+  return 0;
+}
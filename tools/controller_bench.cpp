@@ -0,0 +1,67 @@
+// Host benchmark: the driver built for one controller (AMOLED_CONTROLLER) vs the one reading the ID
+//
+// Build and run from the sketch folder, once per variant, and compare the outputs:
+//   gcc -c -std=gnu11 -I. -Itools/host low_level_amoled.c -o low_level_amoled.o &&
+//   g++ -std=gnu++17 -O2 -I. -Itools -Itools/host tools/controller_bench.cpp tools/host/emu_panel.cpp amoled.cpp
+//       low_level_amoled.o -o controller_bench && ./controller_bench [rounds]
+//   g++ -std=gnu++17 -O2 -DAMOLED_CONTROLLER=CO5300_ID -I. -Itools -Itools/host tools/controller_bench.cpp
+//       tools/host/emu_panel.cpp amoled.cpp low_level_amoled.o -o controller_bench_co5300 && ./controller_bench_co5300
+//
+// Both run the CO5300 emulator. begin() is measured in emulated delay time (the ID read resets the
+// panel on its own), then typical LVGL areas are flushed `rounds` times and the host time per
+// drawArea call and per panel transfer is printed. The emulator decodes every transfer inside
+// these calls, so the times are an upper bound of the driver cost, with the same emulator share
+// in both variants.
+//
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "amoled.h"
+#include "emu_panel.h"
+
+static void on_flush_done(void *) {}
+
+int main(int argc, char **argv)
+{
+  const int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+  emu_reset(CO5300_ID);
+  Amoled amoled;
+  if (!amoled.begin() || amoled.ID() != CO5300_ID)
+  {
+    printf("begin() failed\n");
+    return 1;
+  }
+  amoled.setFlushDoneCallback(on_flush_done, NULL);
+  printf("%s, %s: begin() spends %ld ms in delays\n",
+         AMOLED_CONTROLLER ? "built for one controller" : "controller ID read at begin()", amoled.name(),
+         emu_counters().delay_ms);
+
+  static const struct
+  {
+    const char *name;
+    int x, y, w, h;
+  } areas[] = {
+      {"LVGL band 466x40", 0, 200, DISPLAY_WIDTH, 40},
+      {"top band 466x40 (2-row windows)", 0, 0, DISPLAY_WIDTH, 40},
+      {"label 120x30", 172, 120, 120, 30},
+      {"bubble 64x64", 200, 200, 64, 64},
+  };
+  static uint16_t buf[DISPLAY_WIDTH * 40];
+  for (int i = 0; i < DISPLAY_WIDTH * 40; i++)
+    buf[i] = (uint16_t)rand();
+
+  printf("%-34s %12s %14s\n", "", "ns/drawArea", "ns/transfer");
+  for (const auto &a : areas)
+  {
+    const long transfers0 = emu_counters().color_transfers;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+      amoled.drawArea(a.x, a.y, a.x + a.w - 1, a.y + a.h - 1, buf);
+    emu_complete_all();
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    const long transfers = emu_counters().color_transfers - transfers0;
+    printf("%-34s %12.0f %14.0f\n", a.name, ns / rounds, transfers ? ns / transfers : 0.0);
+  }
+  return 0;
+}
@@ -0,0 +1,504 @@
+// Host check: the unmodified driver (amoled.cpp, low_level_amoled.c) against the panel emulator
+//
+// Build and run from the sketch folder:
+//   gcc -c -std=gnu11 -I. -Itools/host low_level_amoled.c -o low_level_amoled.o &&
+//   g++ -std=gnu++17 -O2 -I. -Itools -Itools/host tools/emu_check.cpp tools/host/emu_panel.cpp amoled.cpp
+//       low_level_amoled.o -o emu_check && ./emu_check
+// Add -DFLUSH_PROFILE=1 to both lines to check the flush profile against the emulator counters too,
+// and -DAMOLED_CONTROLLER=SH8601_ID or CO5300_ID to check a driver built for one controller.
+// The check covers the shadow framebuffer too: run it again with -DSHADOW_FRAMEBUFFER=1 and with
+// -DSHADOW_FRAMEBUFFER=2 on both lines, an area drawn again must then leave its unchanged pixels out.
+//
+// For both controllers: begin() must read the right ID and leave the panel awake, on and in RGB565,
+// then a series of drawArea (staged, zero-copy, odd sizes, bottom edge), fillRect (odd sizes on the
+// edges), drawBitmap (sub-rectangles of a sheet, clipped on every edge) and fillArea (the same as
+// drawArea of one color) calls must leave the emulated frame memory
+// equal to a reference frame inside the circle, through brightness fades and power mode changes
+// sent in the order the panel accepts.
+// The command traffic is printed and the frame is written to emu_<controller>.ppm.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "amoled.h"
+#include "amoled_round.h"
+#include "emu_panel.h"
+
+static uint16_t frame[DISPLAY_HEIGHT][DISPLAY_WIDTH]; // what the panel must show
+
+// The shadow framebuffer compares every area with what the panel holds: none is sent straight from the
+// caller's buffer
+#define ZERO_COPY_FLUSHES (SHADOW_FRAMEBUFFER ? 0u : 1u)
+static int flushes_done;
+
+static void on_flush_done(void *)
+{
+  flushes_done++;
+}
+
+static void fill_random(uint16_t *p, int n)
+{
+  for (int i = 0; i < n; i++)
+    p[i] = (uint16_t)rand();
+}
+
+// Reference for Amoled::drawArea: the area, the padding column on its right (left on the right edge)
+// and the filler row below it (above it on the bottom edge, when the area fits in one strip)
+static void expect_area(int x1, int y1, int w, int h, const uint16_t *src)
+{
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      frame[y1 + y][x1 + x] = src[y * w + x];
+  // On the right edge, the padding column is on the left
+  const int push_w = even_width(w);
+  const int pad_left = (push_w != w && x1 + w == DISPLAY_WIDTH) ? 1 : 0;
+  if (push_w != w)
+    for (int y = 0; y < h; y++)
+      frame[y1 + y][pad_left ? x1 - 1 : x1 + w] = src[y * w + (pad_left ? 0 : w - 1)];
+  if (h & 1)
+  {
+    const int rows = strip_rows(push_w, STRIP_SIZE);
+    const int last = (h - 1) / rows * rows; // first row of the last strip
+    int fy = y1 + h, sy = h - 1;
+    if (fy >= DISPLAY_HEIGHT)
+    {
+      fy = y1 + last - 1;
+      sy = last > 0 ? last - 1 : 0;
+    }
+    for (int x = -pad_left; x < push_w - pad_left; x++)
+      frame[fy][x1 + x] = src[sy * w + (x < 0 ? 0 : x < w ? x : w - 1)];
+  }
+}
+
+// Reference for the strided Amoled::drawBitmap: the visible part of the w x h rectangle at (sx, sy)
+// of a sheet in panel byte order, with the padding column and filler row of an area that size
+static void expect_bitmap(int x, int y, const uint16_t *sheet, int stride, int sx, int sy, int w, int h)
+{
+  const int x1 = x < 0 ? 0 : x, y1 = y < 0 ? 0 : y;
+  const int cw = (x + w > DISPLAY_WIDTH ? DISPLAY_WIDTH : x + w) - x1;
+  const int ch = (y + h > DISPLAY_HEIGHT ? DISPLAY_HEIGHT : y + h) - y1;
+  if (cw <= 0 || ch <= 0)
+    return;
+  static uint16_t area[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+  for (int r = 0; r < ch; r++)
+    for (int c = 0; c < cw; c++)
+    {
+      const uint16_t p = sheet[(sy + y1 - y + r) * stride + sx + x1 - x + c];
+      area[r * cw + c] = (uint16_t)(p << 8 | p >> 8);
+    }
+  expect_area(x1, y1, cw, ch, area);
+}
+
+// Reference for Amoled::fillRect: the padding column (left of it on the right edge), and the row
+// below an odd rect of one strip (above it on the bottom edge)
+static void expect_rect(int x1, int y1, int w, int h, uint16_t color)
+{
+  const int push_w = even_width(w);
+  const int rows = strip_rows(push_w, STRIP_SIZE);
+  const int fill_h = ((h & 1) && h < rows) ? h + 1 : h;
+  if (x1 + push_w > DISPLAY_WIDTH)
+    x1 -= 1;
+  if (y1 + fill_h > DISPLAY_HEIGHT)
+    y1 -= 1;
+  for (int y = y1; y < y1 + fill_h; y++)
+    for (int x = x1; x < x1 + push_w; x++)
+      frame[y][x] = color;
+}
+
+static bool compare(const char *what)
+{
+  emu_complete_all();
+  const uint16_t *fb = emu_framebuffer();
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    int xa = 0, xb = DISPLAY_WIDTH;
+    if (!round_clip(y, 1, xa, xb))
+      continue;
+    for (int x = xa; x < xb; x++)
+      if (fb[y * DISPLAY_WIDTH + x] != frame[y][x])
+      {
+        printf("  %s: pixel %d,%d is %04X instead of %04X\n", what, x, y, fb[y * DISPLAY_WIDTH + x], frame[y][x]);
+        return false;
+      }
+  }
+  return true;
+}
+
+static bool run(uint8_t id, const char *name)
+{
+  printf("%s\n", name);
+  emu_reset(id);
+  Amoled amoled;
+  if (!amoled.begin() || amoled.ID() != id)
+  {
+    printf("  begin() failed or read ID %02X\n", amoled.ID());
+    return false;
+  }
+  const EmuPanelState &st = emu_panel_state();
+  if (!st.awake || !st.display_on || st.colmod != 0x55 || st.madctl != 0 || st.brightness != 0xFF)
+  {
+    printf("  panel left asleep, off or in the wrong mode after begin()\n");
+    return false;
+  }
+  const EmuCounters init = emu_counters();
+  printf("  init: %ld commands, %ld parameter bytes, %ld ms of delays\n", init.commands, init.param_bytes, init.delay_ms);
+  amoled.setFlushDoneCallback(on_flush_done, NULL);
+  flushes_done = 0;
+
+  if (!amoled.fillScreen(AMOLED_COLOR_BLACK))
+    return false;
+  expect_rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, AMOLED_COLOR_BLACK);
+  if (!compare("fillScreen"))
+    return false;
+
+  struct
+  {
+    const char *name;
+    int x, y, w, h;
+    bool dma; // zero-copy candidate
+  } areas[] = {
+      {"full frame", 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, false},
+      {"LVGL band 466x40", 0, 200, DISPLAY_WIDTH, 40, false},
+      {"label 120x30 (zero-copy)", 172, 120, 120, 30, true},
+      {"odd width and height", 150, 150, 101, 77, false},
+      {"odd height on the bottom edge", 180, 401, 100, 65, false},
+      {"odd height, one strip, bottom edge", 200, 435, 60, 31, false},
+      {"odd width on the right edge", DISPLAY_WIDTH - 61, 210, 61, 40, false},
+      {"bubble 64x64", 200, 200, 64, 64, false},
+  };
+  const int n = sizeof(areas) / sizeof(areas[0]);
+  uint16_t *bufs[n];
+  printf("  %-36s %9s %6s %7s %6s %9s\n", "", "commands", "trans", "windows", "RAMWRC", "bytes");
+  for (int i = 0; i < n; i++)
+  {
+    const int count = areas[i].w * areas[i].h;
+    // Not malloc: an address the last driver freed its strips at would still count as DMA-capable
+    bufs[i] = (uint16_t *)heap_caps_malloc(count * 2, areas[i].dma ? MALLOC_CAP_DMA : MALLOC_CAP_8BIT);
+    fill_random(bufs[i], count);
+    expect_area(areas[i].x, areas[i].y, areas[i].w, areas[i].h, bufs[i]); // before, zero-copy swaps in place
+    const EmuCounters c0 = emu_counters();
+    if (!amoled.drawArea(areas[i].x, areas[i].y, areas[i].x + areas[i].w - 1, areas[i].y + areas[i].h - 1, bufs[i]))
+    {
+      printf("  drawArea failed on %s\n", areas[i].name);
+      return false;
+    }
+    emu_complete_all();
+    const EmuCounters &c1 = emu_counters();
+    printf("  %-36s %9ld %6ld %7ld %6ld %9ld\n", areas[i].name, c1.commands - c0.commands,
+           c1.transactions - c0.transactions, c1.windows - c0.windows, c1.ramwrc - c0.ramwrc,
+           c1.color_bytes - c0.color_bytes + c1.param_bytes - c0.param_bytes);
+#if FLUSH_PROFILE
+    amoled.endFrame(); // one area per frame
+    const AmoledFlushProfile &p = amoled.flushProfile();
+    const AmoledFrameProfile &f = amoled.frameProfile();
+    if (p.transfers != c1.color_transfers - c0.color_transfers || p.bytes_sent != c1.color_bytes - c0.color_bytes ||
+        p.windows != c1.windows - c0.windows || amoled.frameCount() != (uint32_t)i + 1 || f.flushes != 1 ||
+        f.sum.bytes_sent != p.bytes_sent || f.latency_max_us != p.latency_us)
+    {
+      printf("  profile of %s: %u transfers, %u windows, %u bytes sent, frame %u of %u flushes\n", areas[i].name,
+             (unsigned)p.transfers, (unsigned)p.windows, (unsigned)p.bytes_sent, (unsigned)amoled.frameCount(),
+             (unsigned)f.flushes);
+      return false;
+    }
+    printf("  %-36s pad %u filler %u bytes, stage %u wait %u call %u latency %u us\n", "", (unsigned)p.pad_bytes,
+           (unsigned)p.filler_bytes, (unsigned)p.stage_us, (unsigned)p.wait_us, (unsigned)p.call_us,
+           (unsigned)p.latency_us);
+#endif
+    if (!compare(areas[i].name))
+      return false;
+  }
+  if (flushes_done != n || amoled.flushStats().zero_copy_flushes != ZERO_COPY_FLUSHES)
+  {
+    printf("  %d flush-done callbacks for %d areas, %u zero-copy flushes\n", flushes_done, n,
+           (unsigned)amoled.flushStats().zero_copy_flushes);
+    return false;
+  }
+#if SHADOW_FRAMEBUFFER
+  // The last area again with one pixel changed: the panel already holds the others
+  {
+    const int i = n - 1;
+    bufs[i][areas[i].w * 10 + 10] ^= 0xFFFF;
+    expect_area(areas[i].x, areas[i].y, areas[i].w, areas[i].h, bufs[i]);
+    const AmoledFlushStats s0 = amoled.flushStats();
+    if (!amoled.drawArea(areas[i].x, areas[i].y, areas[i].x + areas[i].w - 1, areas[i].y + areas[i].h - 1, bufs[i]) ||
+        !compare("area drawn again"))
+      return false;
+    const AmoledFlushStats &s1 = amoled.flushStats();
+    printf("  %-36s %u bytes sent, %u unchanged\n", "area drawn again", (unsigned)(s1.bytes_sent - s0.bytes_sent),
+           (unsigned)(s1.bytes_unchanged - s0.bytes_unchanged));
+    if (s1.bytes_unchanged - s0.bytes_unchanged == 0 || s1.bytes_sent - s0.bytes_sent >= (uint32_t)areas[i].w * 2 * 4)
+    {
+      printf("  the shadow framebuffer sent unchanged pixels\n");
+      return false;
+    }
+  }
+#endif
+  for (int i = 0; i < n; i++)
+    heap_caps_free(bufs[i]);
+
+  // A window of a full-screen buffer LVGL keeps drawing on (DIRECT render mode): sent with its
+  // stride, and left as it was even though it is DMA-capable and full-width
+  {
+    uint16_t *screen = (uint16_t *)heap_caps_malloc(DISPLAY_WIDTH * DISPLAY_HEIGHT * 2, MALLOC_CAP_DMA);
+    fill_random(screen, DISPLAY_WIDTH * DISPLAY_HEIGHT);
+    const uint16_t first = screen[300 * DISPLAY_WIDTH];
+    static uint16_t window[DISPLAY_WIDTH * 60];
+    const struct
+    {
+      int x, y, w, h;
+    } windows[] = {{120, 80, 151, 41}, {0, 300, DISPLAY_WIDTH, 60}};
+    for (const auto &r : windows)
+    {
+      for (int y = 0; y < r.h; y++)
+        for (int x = 0; x < r.w; x++)
+          window[y * r.w + x] = screen[(r.y + y) * DISPLAY_WIDTH + r.x + x];
+      expect_area(r.x, r.y, r.w, r.h, window);
+      if (!amoled.drawArea(r.x, r.y, r.x + r.w - 1, r.y + r.h - 1, screen + r.y * DISPLAY_WIDTH + r.x, DISPLAY_WIDTH) ||
+          !compare("window of a full-screen buffer"))
+        return false;
+    }
+    if (screen[300 * DISPLAY_WIDTH] != first || amoled.flushStats().zero_copy_flushes != ZERO_COPY_FLUSHES)
+    {
+      printf("  a strided source was swapped in place\n");
+      return false;
+    }
+    heap_caps_free(screen);
+  }
+
+  // Rects and a bitmap already in panel byte order
+  if (!amoled.fillRect(200, 300, 33, 21, 0xF800) || !amoled.fillRect(120, 100, 226, 4, 0x07E0))
+    return false;
+  expect_rect(200, 300, 33, 21, 0xF800);
+  expect_rect(120, 100, 226, 4, 0x07E0);
+  static uint16_t bitmap[40 * 40];
+  for (int y = 0; y < 40; y++)
+    for (int x = 0; x < 40; x++)
+    {
+      const uint16_t c = (uint16_t)rand();
+      frame[300 + y][100 + x] = c;
+      bitmap[y * 40 + x] = (uint16_t)(c << 8 | c >> 8);
+    }
+  if (!amoled.drawBitmap(100, 300, bitmap, 40, 40) || !compare("fillRect and drawBitmap"))
+    return false;
+
+  // Odd rects on the right and bottom edges, and in the corner (only visible with DISPLAY_ROUND 0):
+  // the padding column and the filler row must stay on the screen
+  const struct
+  {
+    int x, y, w, h;
+    uint16_t color;
+  } edge_rects[] = {
+      {DISPLAY_WIDTH - 33, 221, 33, 15, 0x001F},
+      {211, DISPLAY_HEIGHT - 7, 45, 7, 0xFFE0},
+      {DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1, 1, 1, 0xFFFF},
+  };
+  for (const auto &r : edge_rects)
+  {
+    const long out0 = emu_counters().out_of_frame;
+    expect_rect(r.x, r.y, r.w, r.h, r.color);
+    if (!amoled.fillRect(r.x, r.y, r.w, r.h, r.color) || !compare("fillRect on an edge"))
+      return false;
+    if (emu_counters().out_of_frame != out0)
+    {
+      printf("  fillRect of %dx%d at %d,%d wrote outside of the frame\n", r.w, r.h, r.x, r.y);
+      return false;
+    }
+  }
+
+  // Sub-rectangles of a sprite sheet, partly off every edge of the screen: only the visible part is sent
+  const int sheet_w = 130, sheet_h = 90;
+  static uint16_t sheet[sheet_w * sheet_h];
+  fill_random(sheet, sheet_w * sheet_h);
+  struct
+  {
+    int x, y, sx, sy, w, h;
+  } blits[] = {
+      {151, 181, 7, 3, 61, 47},  // odd sizes inside the screen
+      {-20, 210, 10, 5, 57, 41}, // off the left edge
+      {200, -9, 33, 40, 64, 37}, // off the top edge
+      {DISPLAY_WIDTH - 31, 190, 0, 0, 80, 50},  // off the right edge
+      {190, DISPLAY_HEIGHT - 25, 50, 20, 63, 60}, // off the bottom edge, odd height left
+      {-200, 100, 0, 0, 100, 40}, // not visible at all
+  };
+  const int areas_done = flushes_done;
+  for (const auto &b : blits)
+  {
+    expect_bitmap(b.x, b.y, sheet, sheet_w, b.sx, b.sy, b.w, b.h);
+    if (!amoled.drawBitmap(b.x, b.y, sheet, sheet_w, b.sx, b.sy, b.w, b.h))
+    {
+      printf("  drawBitmap of %dx%d at %d,%d failed\n", b.w, b.h, b.x, b.y);
+      return false;
+    }
+    if (!compare("drawBitmap of a sub-rectangle"))
+      return false;
+  }
+  if (amoled.drawBitmap(0, 0, sheet, sheet_w, 100, 0, 31, 10) || flushes_done != areas_done)
+  {
+    printf("  a rectangle outside its sheet was drawn, or a bitmap called the flush-done callback\n");
+    return false;
+  }
+
+  // Solid areas (the bands of a plain background): fillArea must leave the panel exactly as drawArea
+  // of the same area filled with the color, end with one flush-done callback and stage nothing
+  struct
+  {
+    int x, y, w, h;
+    uint16_t color;
+  } fills[] = {
+      {0, 200, DISPLAY_WIDTH, 40, 0x1234},                 // LVGL band
+      {0, 240, DISPLAY_WIDTH, 40, 0x1234},                 // the next one, same color
+      {0, 0, DISPLAY_WIDTH, 40, 0xF81F},                   // top band, mostly outside the circle
+      {151, 181, 61, 47, 0x07E0},                          // odd sizes
+      {DISPLAY_WIDTH - 31, 190, 31, 21, 0x001F},           // odd width on the right edge
+      {190, DISPLAY_HEIGHT - 25, 63, 25, 0xFFE0},          // odd height on the bottom edge, one strip
+      {0, DISPLAY_HEIGHT - 101, DISPLAY_WIDTH, 101, 0x8410}, // odd height on the bottom edge, several strips
+      {0, 0, 20, 20, 0xFFFF},                              // not visible at all
+  };
+  static uint16_t solid[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+  static uint16_t panel[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+  for (const auto &f : fills)
+  {
+    for (int i = 0; i < f.w * f.h; i++)
+      solid[i] = f.color;
+    expect_area(f.x, f.y, f.w, f.h, solid);
+    const int done = flushes_done;
+    const AmoledFlushStats st = amoled.flushStats();
+    if (!amoled.fillArea(f.x, f.y, f.x + f.w - 1, f.y + f.h - 1, f.color) || !compare("fillArea"))
+      return false;
+    amoled.endFrame();
+    if (flushes_done != done + 1 || amoled.flushStats().bytes_copied != st.bytes_copied ||
+        amoled.flushStats().fill_flushes != st.fill_flushes + 1)
+    {
+      printf("  fillArea of %dx%d at %d,%d: %d flush-done callbacks, %u bytes staged\n", f.w, f.h, f.x, f.y,
+             flushes_done - done, (unsigned)(amoled.flushStats().bytes_copied - st.bytes_copied));
+      return false;
+    }
+    // drawArea of the same pixels changes nothing, outside the circle included
+    memcpy(panel, emu_framebuffer(), sizeof(panel));
+    if (!amoled.drawArea(f.x, f.y, f.x + f.w - 1, f.y + f.h - 1, solid))
+      return false;
+    emu_complete_all();
+    amoled.endFrame();
+    if (memcmp(panel, emu_framebuffer(), sizeof(panel)))
+    {
+      printf("  fillArea of %dx%d at %d,%d differs from drawArea\n", f.w, f.h, f.x, f.y);
+      return false;
+    }
+  }
+
+  if (!amoled.invertColor(true) || !emu_panel_state().inverted || !amoled.invertColor(false) || emu_panel_state().inverted)
+    return false;
+
+  // A fade while areas keep being flushed: its steps only go out between transfers
+  if (!amoled.setBrightness(0) || emu_panel_state().brightness != 0)
+    return false;
+  amoled.fadeBrightness(0xC0, 200);
+  emu_record(true);
+  static uint16_t bubble[64 * 64];
+  int frames = 0;
+  for (bool fading = true; fading && frames < 1000; frames++)
+  {
+    fill_random(bubble, 64 * 64);
+    expect_area(200, 200, 64, 64, bubble);
+    vTaskDelay(2);
+    amoled.drawArea(200, 200, 263, 263, bubble);
+    amoled.updateBrightness(); // the area is still in flight
+    vTaskDelay(5);
+    fading = amoled.updateBrightness();
+  }
+  emu_record(false);
+  int steps = 0, busy = 0;
+  for (const EmuTransaction &t : emu_transactions())
+    if (t.cmd == 0x51)
+    {
+      steps++;
+      busy += t.queued > 0;
+    }
+  printf("  fade to C0 in %d frames: %d brightness commands, %d sent with pixels in flight\n", frames, steps, busy);
+  if (emu_panel_state().brightness != 0xC0 || busy || steps > 200 / BRIGHTNESS_STEP_MS + 2 || !compare("fade"))
+    return false;
+
+  // Power modes: idle and partial survive a sleep, drawArea wakes the panel, sleep in/outs are spaced
+  if (!amoled.setPartialArea(180, 286) || !amoled.setPowerMode(AMOLED_POWER_IDLE | AMOLED_POWER_PARTIAL) ||
+      !emu_panel_state().idle || !emu_panel_state().partial || emu_panel_state().partial_top != 180 ||
+      emu_panel_state().partial_bottom != 286)
+    return false;
+  vTaskDelay(50);
+  if (!amoled.setPowerMode(AMOLED_POWER_SLEEP | AMOLED_POWER_IDLE | AMOLED_POWER_PARTIAL) || emu_panel_state().awake ||
+      emu_panel_state().display_on)
+    return false;
+  vTaskDelay(500);
+  fill_random(bubble, 64 * 64);
+  expect_area(200, 200, 64, 64, bubble);
+  if (!amoled.drawArea(200, 200, 263, 263, bubble) || amoled.powerMode() != (AMOLED_POWER_IDLE | AMOLED_POWER_PARTIAL))
+    return false;
+  emu_complete_all();
+  if (!emu_panel_state().awake || !emu_panel_state().display_on || !emu_panel_state().idle ||
+      !emu_panel_state().partial || !compare("wake on drawArea"))
+    return false;
+  if (!amoled.setPowerMode(AMOLED_POWER_SLEEP) || emu_panel_state().idle || emu_panel_state().partial ||
+      !amoled.setPowerMode(AMOLED_POWER_NORMAL) || !emu_panel_state().awake || !emu_panel_state().display_on)
+    return false;
+  static const uint8_t policy_modes[] = {AMOLED_POWER_NORMAL, AMOLED_POWER_NORMAL, AMOLED_POWER_IDLE,
+                                         AMOLED_POWER_IDLE, AMOLED_POWER_SLEEP, AMOLED_POWER_NORMAL};
+  amoled.setPowerPolicy(
+      [](uint32_t inactive_ms, void *) -> uint8_t
+      {
+        return inactive_ms < 1000 ? AMOLED_POWER_NORMAL : inactive_ms < 3000 ? AMOLED_POWER_IDLE : AMOLED_POWER_SLEEP;
+      },
+      NULL);
+  for (int i = 0; i < (int)sizeof(policy_modes); i++)
+  {
+    vTaskDelay(100);
+    if (amoled.updatePower(i < 5 ? i * 800 : 0) != policy_modes[i])
+      return false;
+  }
+  amoled.setPowerPolicy(NULL, NULL);
+  const AmoledPowerStats &ps = amoled.powerStats();
+  printf("  power: %u changes, %u wakes (last %u us, max %u us), normal %u idle %u partial %u sleep %u ms\n",
+         (unsigned)ps.changes, (unsigned)ps.wakes, (unsigned)ps.wake_us, (unsigned)ps.wake_max_us,
+         (unsigned)ps.normal_ms, (unsigned)ps.idle_ms, (unsigned)ps.partial_ms, (unsigned)ps.sleep_ms);
+  if (ps.wakes != 3 || ps.wake_us < SLEEP_OUT_MS * 1000 || ps.sleep_ms < 500 || ps.partial_ms < 50 ||
+      emu_counters().bad_sequence || !compare("power modes"))
+  {
+    printf("  %ld commands out of sequence\n", emu_counters().bad_sequence);
+    return false;
+  }
+
+  const EmuCounters &c = emu_counters();
+  printf("  total: %ld commands, %ld transactions, %ld color transfers, %ld windows, %ld RAMWR, %ld RAMWRC,\n"
+         "         %ld pixel bytes, %ld parameter bytes, %ld queue waits\n",
+         c.commands, c.transactions, c.color_transfers, c.windows, c.ramwr, c.ramwrc, c.color_bytes, c.param_bytes,
+         c.queue_waits);
+  if (c.unknown_commands || c.bad_opcodes || c.odd_windows || c.out_of_frame || c.bad_continue || c.not_ready ||
+      c.bad_sequence)
+  {
+    printf("  %ld unknown commands, %ld bad opcodes, %ld odd windows, %ld pixels out of the frame, %ld bad RAMWRC, "
+           "%ld pixels before the panel was ready, %ld commands out of sequence\n",
+           c.unknown_commands, c.bad_opcodes, c.odd_windows, c.out_of_frame, c.bad_continue, c.not_ready,
+           c.bad_sequence);
+    return false;
+  }
+  char path[64];
+  snprintf(path, sizeof(path), "emu_%s.ppm", name);
+  if (!emu_dump_ppm(path))
+    return false;
+  printf("  frame written to %s\n\n", path);
+  return true;
+}
+
+int main()
+{
+#if AMOLED_CONTROLLER
+  // Built for one controller, the other one cannot be driven
+  if (!run(AMOLED_CONTROLLER, AmoledController<AMOLED_CONTROLLER>::name))
+#else
+  if (!run(SH8601_ID, SH8601_NAME) || !run(CO5300_ID, CO5300_NAME))
+#endif
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf(AMOLED_CONTROLLER ? "The controller shows the reference frame\n" : "Both controllers show the reference frame\n");
+  return 0;
+}
@@ -0,0 +1,13 @@
+// Host stand-in for the Arduino core header (see emu_panel.h), only what the display driver uses
+//
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
@@ -0,0 +1,835 @@
+// Host emulator of the QSPI panel and of the ESP-IDF, FreeRTOS and GPIO calls the driver makes
+// (see emu_panel.h)
+//
+#include <deque>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "emu_panel.h"
+#include "panel_model.h"
+#include "amoled_te.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_ops.h"
+#include "esp_lcd_panel_interface.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define OPCODE_WRITE_CMD 0x02
+#define OPCODE_READ_CMD 0x03
+#define OPCODE_WRITE_COLOR 0x32
+
+// Part of a tx_color, one SPI transaction
+struct Chunk
+{
+  const uint8_t *data;
+  size_t len;
+  uint8_t cmd;
+  bool first, last;
+  int index; // in the recorded transactions, -1 when not recorded
+};
+
+struct esp_lcd_panel_io_t
+{
+  esp_lcd_panel_io_spi_config_t config;
+  esp_lcd_panel_io_color_trans_done_cb_t on_color_trans_done;
+  void *user_ctx;
+};
+
+// Each unit remembers the transaction whose completion gave it (-1: given by the CPU)
+struct emu_semaphore
+{
+  UBaseType_t max;
+  std::deque<int> units;
+};
+
+static struct
+{
+  uint8_t controller_id;
+  PanelModel model; // pixels as RGB565 values
+  EmuPanelState state;
+  EmuCounters counters;
+  bool bus_ready;
+  int max_transfer_sz;
+  esp_lcd_panel_io_t io;
+  bool io_ready;
+  std::deque<Chunk> inflight;
+  int odd_byte; // first byte of a pixel split between two chunks, -1 when none
+  bool record;
+  std::vector<EmuTransaction> trace;
+  int completing, depend;
+  std::map<const uint8_t *, size_t> dma_blocks;
+  // Bit-banged ID read: 32 bits shifted in on D0 at rising clock edges, then the ID shifted out
+  int levels[64];
+  uint32_t shift_in;
+  int bits_in, bits_out;
+  int64_t id_read_start;
+  bool spi_device; // the SPI device of the ID read is on the bus
+  // Emulated time and TE line
+  int64_t skipped_us; // delays that returned at once
+  uint32_t te_period;
+  int64_t te_next;    // time of the next pulse
+  gpio_isr_t te_isr;
+  void *te_arg;
+  bool in_te;         // the TE handler is running
+  int in_isr;         // a transfer-done or TE callback is running (xPortInIsrContext)
+  int64_t sleep_changed; // time of the last sleep in/out
+} emu;
+
+static void reset_panel_state()
+{
+  memset(&emu.state, 0, sizeof(emu.state));
+  emu.state.colmod = 0x66; // reset value of the controllers, 18-bit
+  emu.model.reset(emu.controller_id == CO5300_ID ? 6 : 0);
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+      emu.model.fb[y][x] = 0xDEAD;
+}
+
+void emu_reset(uint8_t controller_id)
+{
+  emu.controller_id = controller_id;
+  reset_panel_state();
+  memset(&emu.counters, 0, sizeof(emu.counters));
+  emu.bus_ready = false;
+  emu.max_transfer_sz = 4092;
+  memset(&emu.io, 0, sizeof(emu.io));
+  emu.io_ready = false;
+  emu.inflight.clear();
+  emu.odd_byte = -1;
+  emu.trace.clear();
+  emu.completing = emu.depend = -1;
+  memset(emu.levels, 0, sizeof(emu.levels));
+  emu.shift_in = 0;
+  emu.bits_in = emu.bits_out = 0;
+  emu.spi_device = false;
+  emu.te_period = 0;
+  emu.te_isr = NULL;
+  emu.in_te = false;
+  emu.in_isr = 0;
+  emu.sleep_changed = INT64_MIN / 2;
+}
+
+int64_t emu_time_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + emu.skipped_us;
+}
+
+void emu_te_start(uint32_t period_us)
+{
+  emu.te_period = period_us;
+  emu.te_next = emu_time_us() + period_us;
+}
+
+int emu_scan_line(int64_t time_us)
+{
+  if (!emu.te_period)
+    return -1;
+  const int64_t since = (time_us - emu.te_next) % emu.te_period;
+  return te_scan_line((uint32_t)(since < 0 ? since + emu.te_period : since), emu.te_period);
+}
+
+// Run the TE handler for the pulses the emulated time went past, as one (a pending GPIO
+// interrupt is only taken once)
+static void te_poll()
+{
+  if (!emu.te_period || !emu.te_isr || emu.in_te)
+    return;
+  const int64_t now = emu_time_us();
+  if (now < emu.te_next)
+    return;
+  while (emu.te_next <= now)
+    emu.te_next += emu.te_period;
+  emu.in_te = true;
+  emu.in_isr++;
+  emu.te_isr(emu.te_arg);
+  emu.in_isr--;
+  emu.in_te = false;
+}
+
+void emu_record(bool on)
+{
+  emu.record = on;
+}
+
+const std::vector<EmuTransaction> &emu_transactions()
+{
+  return emu.trace;
+}
+
+const EmuCounters &emu_counters()
+{
+  EmuCounters &c = emu.counters;
+  c.windows = emu.model.windows;
+  c.ramwr = emu.model.ramwr;
+  c.ramwrc = emu.model.ramwrc;
+  c.odd_windows = emu.model.odd_windows;
+  c.out_of_frame = emu.model.out_of_frame;
+  c.bad_continue = emu.model.bad_continue;
+  return c;
+}
+
+const EmuPanelState &emu_panel_state()
+{
+  return emu.state;
+}
+
+const uint16_t *emu_framebuffer()
+{
+  return &emu.model.fb[0][0];
+}
+
+bool emu_dump_ppm(const char *path)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  fprintf(f, "P6\n%d %d\n255\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      const uint16_t c = emu.model.fb[y][x];
+      const uint8_t rgb[3] = {(uint8_t)((c >> 11) * 255 / 31), (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+                              (uint8_t)((c & 0x1F) * 255 / 31)};
+      fwrite(rgb, 1, 3, f);
+    }
+  return fclose(f) == 0;
+}
+
+static int trace(uint8_t cmd, bool color, bool first, const void *data, size_t bytes)
+{
+  if (!emu.record)
+    return -1;
+  emu.trace.push_back({cmd, color, first, (int)bytes, data, (int)emu.inflight.size() + (color ? 1 : 0), emu.depend,
+                       emu_time_us()});
+  return (int)emu.trace.size() - 1;
+}
+
+int emu_completing()
+{
+  return emu.completing;
+}
+
+void emu_depend(int index)
+{
+  if (index > emu.depend)
+    emu.depend = index;
+}
+
+static bool ready_for_pixels()
+{
+  return emu.state.awake && emu.state.display_on && (emu.state.colmod & 0x07) == 0x05;
+}
+
+// Pixels arrive big-endian, two bytes each
+static void write_pixels(const uint8_t *data, size_t len)
+{
+  uint16_t px[256];
+  while (len)
+  {
+    int n = 0;
+    if (emu.odd_byte >= 0)
+    {
+      px[n++] = (uint16_t)(emu.odd_byte << 8 | data[0]);
+      emu.odd_byte = -1;
+      data++;
+      len--;
+    }
+    for (; n < 256 && len >= 2; n++, data += 2, len -= 2)
+      px[n] = (uint16_t)(data[0] << 8 | data[1]);
+    if (len == 1)
+    {
+      emu.odd_byte = data[0];
+      len = 0;
+    }
+    if (!ready_for_pixels())
+      emu.counters.not_ready += n;
+    emu.model.put(px, n);
+  }
+}
+
+static void command(uint8_t cmd, const uint8_t *p, size_t n);
+
+static void complete_oldest()
+{
+  const Chunk c = emu.inflight.front();
+  emu.inflight.pop_front();
+  const bool pixels = c.cmd == 0x2C || c.cmd == 0x3C;
+  if (c.first)
+  {
+    emu.odd_byte = -1;
+    if (pixels)
+      emu.model.start(c.cmd == 0x3C);
+    else
+      command(c.cmd, NULL, 0);
+  }
+  if (pixels)
+    write_pixels(c.data, c.len);
+  if (c.last && emu.io.on_color_trans_done)
+  {
+    esp_lcd_panel_io_event_data_t edata;
+    emu.completing = c.index;
+    emu.in_isr++;
+    emu.io.on_color_trans_done(&emu.io, &edata, emu.io.user_ctx);
+    emu.in_isr--;
+    emu.completing = -1;
+  }
+}
+
+static void drain()
+{
+  while (!emu.inflight.empty())
+    complete_oldest();
+}
+
+void emu_complete_all()
+{
+  if (!emu.inflight.empty())
+    emu_depend(emu.inflight.back().index);
+  drain();
+}
+
+bool emu_complete_one()
+{
+  if (emu.inflight.empty())
+    return false;
+  emu_depend(emu.inflight.front().index);
+  complete_oldest();
+  return true;
+}
+
+// Panel side of a command with its parameters
+static void command(uint8_t cmd, const uint8_t *p, size_t n)
+{
+  switch (cmd)
+  {
+  case 0x01: // SWRESET
+    reset_panel_state();
+    return;
+  case 0x2A: // CASET
+    if (n == 4)
+      emu.model.caset(p[0] << 8 | p[1], p[2] << 8 | p[3]);
+    return;
+  case 0x2B: // RASET
+    if (n == 4)
+      emu.model.raset(p[0] << 8 | p[1], p[2] << 8 | p[3]);
+    return;
+  }
+  emu.model.command(cmd);
+  switch (cmd)
+  {
+  case 0x10:
+    emu.state.awake = false;
+    break;
+  case 0x11:
+    emu.state.awake = true;
+    break;
+  case 0x12:
+    if (emu.state.partial_bottom <= emu.state.partial_top)
+      emu.counters.bad_sequence++;
+    emu.state.partial = true;
+    break;
+  case 0x13:
+    emu.state.partial = false;
+    break;
+  case 0x20:
+  case 0x21:
+    emu.state.inverted = cmd == 0x21;
+    break;
+  case 0x28:
+  case 0x29:
+    emu.state.display_on = cmd == 0x29;
+    break;
+  case 0x34:
+  case 0x35:
+    emu.state.te_on = cmd == 0x35;
+    break;
+  case 0x30:
+    if (n == 4)
+    {
+      emu.state.partial_top = p[0] << 8 | p[1];
+      emu.state.partial_bottom = (p[2] << 8 | p[3]) + 1;
+    }
+    break;
+  case 0x36:
+    if (n)
+      emu.state.madctl = p[0];
+    break;
+  case 0x38:
+  case 0x39:
+    emu.state.idle = cmd == 0x39;
+    break;
+  case 0x3A:
+    if (n)
+      emu.state.colmod = p[0];
+    break;
+  case 0x51:
+    if (n)
+      emu.state.brightness = p[0];
+    break;
+  case 0x2C: // memory writes without pixels
+  case 0x3C:
+  case 0x44: // tear scanline
+  case 0x53: // brightness control
+    break;
+  case 0x63: // CO5300: high brightness mode level
+  case 0xC4: // CO5300: SPI mode control
+    if (emu.controller_id != CO5300_ID)
+      emu.counters.unknown_commands++;
+    break;
+  default:
+    emu.counters.unknown_commands++;
+    break;
+  }
+}
+
+extern "C" {
+
+// Memory
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+  uint8_t *p = (uint8_t *)malloc(size);
+  if (!p)
+    return NULL;
+  // Blocks are given back with free(), drop what a recycled address was before
+  auto it = emu.dma_blocks.lower_bound(p);
+  if (it != emu.dma_blocks.begin())
+    --it;
+  while (it != emu.dma_blocks.end() && it->first < p + size)
+    it = (it->first + it->second > p) ? emu.dma_blocks.erase(it) : std::next(it);
+  if (caps & MALLOC_CAP_DMA)
+    emu.dma_blocks[p] = size;
+  return p;
+}
+
+void heap_caps_free(void *ptr)
+{
+  emu.dma_blocks.erase((const uint8_t *)ptr);
+  free(ptr);
+}
+
+bool esp_ptr_dma_capable(const void *ptr)
+{
+  const uint8_t *p = (const uint8_t *)ptr;
+  auto it = emu.dma_blocks.upper_bound(p);
+  if (it == emu.dma_blocks.begin())
+    return false;
+  --it;
+  return p < it->first + it->second;
+}
+
+// FreeRTOS
+
+void vTaskDelay(TickType_t ticks)
+{
+  emu.counters.delay_ms += ticks;
+  emu.skipped_us += (int64_t)ticks * 1000;
+  te_poll();
+  emu_complete_all();
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+  return emu.in_isr > 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  static int main_task;
+  return (TaskHandle_t)&main_task;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+  static char name[] = "main";
+  return (task && task != xTaskGetCurrentTaskHandle()) ? NULL : name;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+  SemaphoreHandle_t s = new emu_semaphore;
+  s->max = max_count;
+  s->units.assign(initial_count, -1);
+  return s;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+  delete sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+  while (sem->units.empty())
+  {
+    if (ticks == 0)
+      return pdFALSE;
+    if (emu.inflight.empty() && emu.te_period && emu.te_isr && !emu.in_te)
+    {
+      // Nothing else can give it: time passes up to the next TE pulse, if the wait lasts that long
+      const int64_t wait = emu.te_next - emu_time_us();
+      if (ticks != portMAX_DELAY && wait > (int64_t)ticks * 1000)
+      {
+        emu.skipped_us += (int64_t)ticks * 1000;
+        return pdFALSE;
+      }
+      if (wait > 0)
+        emu.skipped_us += wait;
+      te_poll();
+      continue;
+    }
+    if (emu.inflight.empty())
+    {
+      if (ticks != portMAX_DELAY)
+        return pdFALSE;
+      fprintf(stderr, "emu: waiting forever on a semaphore with no transfer in flight\n");
+      abort();
+    }
+    complete_oldest();
+  }
+  emu_depend(sem->units.front());
+  sem->units.pop_front();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+  if (sem->units.size() >= sem->max)
+    return pdFALSE;
+  sem->units.push_back(emu.completing);
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+  if (woken)
+    *woken = pdFALSE;
+  return xSemaphoreGive(sem);
+}
+
+// Time
+
+int64_t esp_timer_get_time(void)
+{
+  // Inside the TE handler, the time of the pulse
+  if (emu.in_te)
+    return emu.te_next - emu.te_period;
+  te_poll();
+  return emu_time_us();
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+  emu.skipped_us += us;
+  te_poll();
+}
+
+// GPIO, only the lines read_lcd_id() bit-bangs and the TE line are followed
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+  return cfg ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+  return (gpio_num >= 0 && gpio_num < 64) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+  return (gpio_num >= 0 && gpio_num < 64) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_pullup_en(gpio_num_t gpio_num)
+{
+  return (gpio_num >= 0 && gpio_num < 64) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_pullup_dis(gpio_num_t gpio_num)
+{
+  return (gpio_num >= 0 && gpio_num < 64) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+  if (gpio_num < 0 || gpio_num >= 64)
+    return ESP_ERR_INVALID_ARG;
+  const int was = emu.levels[gpio_num];
+  emu.levels[gpio_num] = level ? 1 : 0;
+  if (gpio_num == PIN_NUM_LCD_RST && was && !level)
+  {
+    reset_panel_state();
+    emu.shift_in = 0;
+    emu.bits_in = emu.bits_out = 0;
+  }
+  if (gpio_num == PIN_NUM_LCD_PCLK && !was && level)
+  {
+    if (emu.bits_in == 0)
+      emu.id_read_start = emu_time_us();
+    if (emu.bits_in < 32)
+    {
+      emu.shift_in = emu.shift_in << 1 | emu.levels[PIN_NUM_LCD_DATA0];
+      emu.bits_in++;
+    }
+    else
+      emu.bits_out++;
+  }
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+  // The answer to a read of 0xDA (controller ID), MSB first, one bit per clock
+  if (gpio_num == PIN_NUM_LCD_DATA0 && emu.bits_in == 32 &&
+      emu.shift_in == ((uint32_t)OPCODE_READ_CMD << 24 | 0xDA << 8))
+  {
+    if (emu.bits_out == 0)
+      emu.counters.id_reads++;
+    if (emu.bits_out == 7)
+      emu.counters.id_read_us = (long)(emu_time_us() - emu.id_read_start);
+    return emu.bits_out < 8 ? (emu.controller_id >> (7 - emu.bits_out)) & 1 : 0;
+  }
+  return (gpio_num >= 0 && gpio_num < 64) ? emu.levels[gpio_num] : 0;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+  return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+  if (gpio_num < 0 || gpio_num >= 64)
+    return ESP_ERR_INVALID_ARG;
+  if (gpio_num == PIN_NUM_LCD_TE)
+  {
+    emu.te_isr = isr_handler;
+    emu.te_arg = args;
+  }
+  return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+  if (gpio_num == PIN_NUM_LCD_TE)
+    emu.te_isr = NULL;
+  return ESP_OK;
+}
+
+// SPI bus and panel IO
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+  if (!bus_config || host_id != LCD_HOST)
+    return ESP_ERR_INVALID_ARG;
+  if (emu.bus_ready)
+    return ESP_ERR_INVALID_STATE;
+  if (bus_config->data0_io_num != PIN_NUM_LCD_DATA0 || bus_config->data1_io_num != PIN_NUM_LCD_DATA1 ||
+      bus_config->data2_io_num != PIN_NUM_LCD_DATA2 || bus_config->data3_io_num != PIN_NUM_LCD_DATA3 ||
+      bus_config->sclk_io_num != PIN_NUM_LCD_PCLK)
+    return ESP_ERR_INVALID_ARG;
+  emu.max_transfer_sz = bus_config->max_transfer_sz > 0 ? bus_config->max_transfer_sz : 4092;
+  emu.bus_ready = true;
+  return ESP_OK;
+}
+
+// A device sharing the CS line of the panel IO, before it is created: the panel answers a read of
+// register 0xDA (opcode 0x03, 24-bit address 0x00DA00) on D0 with its controller ID
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+  if (!dev_config || !handle || host_id != LCD_HOST || !emu.bus_ready)
+    return ESP_ERR_INVALID_ARG;
+  if (emu.spi_device || (emu.io_ready && dev_config->spics_io_num == PIN_NUM_LCD_CS))
+    return ESP_ERR_INVALID_STATE; // the CS line is taken
+  if (dev_config->spics_io_num != PIN_NUM_LCD_CS || dev_config->command_bits != 8 || dev_config->address_bits != 24 ||
+      (dev_config->flags & (SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX)) != (SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX) ||
+      dev_config->mode != 0 || dev_config->clock_speed_hz <= 0)
+    return ESP_ERR_NOT_SUPPORTED;
+  static int clock_hz;
+  clock_hz = dev_config->clock_speed_hz;
+  emu.spi_device = true;
+  *handle = (spi_device_handle_t)&clock_hz;
+  return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+  if (!handle || !emu.spi_device)
+    return ESP_ERR_INVALID_ARG;
+  emu.spi_device = false;
+  return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *t)
+{
+  if (!handle || !t || !emu.spi_device || t->length)
+    return ESP_ERR_INVALID_ARG;
+  const int clock_hz = *(const int *)handle;
+  const size_t bits = 8 + 24 + t->rxlength;
+  const int64_t us = (int64_t)(bits * 1000000 + clock_hz - 1) / clock_hz;
+  emu.skipped_us += us;
+  uint8_t answer = 0xFF; // nothing drives D0, the pull-up reads ones
+  if (t->cmd == OPCODE_READ_CMD && t->addr == 0xDA << 8 && emu.levels[PIN_NUM_LCD_RST])
+  {
+    answer = emu.controller_id;
+    emu.counters.id_reads++;
+    emu.counters.id_read_us = (long)us;
+  }
+  uint8_t *rx = (t->flags & SPI_TRANS_USE_RXDATA) ? t->rx_data : (uint8_t *)t->rx_buffer;
+  for (size_t i = 0; rx && i < (t->rxlength + 7) / 8; i++)
+    rx[i] = answer;
+  return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_io_spi(esp_lcd_spi_bus_handle_t bus, const esp_lcd_panel_io_spi_config_t *io_config,
+                                   esp_lcd_panel_io_handle_t *ret_io)
+{
+  if (!emu.bus_ready || !io_config || !ret_io || (spi_host_device_t)(intptr_t)bus != LCD_HOST)
+    return ESP_ERR_INVALID_ARG;
+  if (emu.spi_device)
+    return ESP_ERR_INVALID_STATE; // the ID read device still holds the CS line
+  // The QSPI opcodes go in a 32-bit command phase, pixels on four lines
+  if (io_config->lcd_cmd_bits != 32 || io_config->lcd_param_bits != 8 || !io_config->flags.quad_mode ||
+      io_config->trans_queue_depth == 0)
+    return ESP_ERR_NOT_SUPPORTED;
+  emu.io.config = *io_config;
+  emu.io.on_color_trans_done = io_config->on_color_trans_done;
+  emu.io.user_ctx = io_config->user_ctx;
+  emu.io_ready = true;
+  *ret_io = &emu.io;
+  return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_register_event_callbacks(esp_lcd_panel_io_handle_t io, const esp_lcd_panel_io_callbacks_t *cbs,
+                                                    void *user_ctx)
+{
+  if (io != &emu.io || !cbs)
+    return ESP_ERR_INVALID_ARG;
+  io->on_color_trans_done = cbs->on_color_trans_done;
+  io->user_ctx = user_ctx;
+  return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_tx_param(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void *param, size_t param_size)
+{
+  if (io != &emu.io || !emu.io_ready || (param_size && !param))
+    return ESP_ERR_INVALID_ARG;
+  // Parameters are sent polling, after every color transfer queued before them
+  const uint8_t opcode = (uint8_t)((uint32_t)lcd_cmd >> 24);
+  const uint8_t cmd = (uint8_t)(lcd_cmd >> 8);
+  trace(cmd, false, true, param, param_size);
+  drain();
+  emu.counters.commands++;
+  emu.counters.transactions++;
+  emu.counters.param_bytes += param_size;
+  if (opcode != OPCODE_WRITE_CMD)
+  {
+    emu.counters.bad_opcodes++;
+    return ESP_OK;
+  }
+  // The panel takes no command for 5 ms after a sleep in/out, and no other one of them for 120 ms
+  const int64_t now = emu_time_us();
+  const bool sleep_cmd = cmd == 0x10 || cmd == 0x11;
+  if (now - emu.sleep_changed < (sleep_cmd ? 120000 : 5000))
+    emu.counters.bad_sequence++;
+  if (sleep_cmd)
+    emu.sleep_changed = now;
+  command(cmd, (const uint8_t *)param, param_size);
+  return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_tx_color(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void *color, size_t color_size)
+{
+  if (io != &emu.io || !emu.io_ready || !color || !color_size)
+    return ESP_ERR_INVALID_ARG;
+  const uint8_t opcode = (uint8_t)((uint32_t)lcd_cmd >> 24);
+  const uint8_t cmd = (uint8_t)(lcd_cmd >> 8);
+  if (opcode != OPCODE_WRITE_COLOR)
+  {
+    emu.counters.bad_opcodes++;
+    return ESP_OK;
+  }
+  emu.counters.commands++;
+  // The command reaches the panel with the first chunk, its pixels when each chunk completes
+  const uint8_t *data = (const uint8_t *)color;
+  for (size_t done = 0; done < color_size;)
+  {
+    if (emu.inflight.size() >= emu.io.config.trans_queue_depth)
+    {
+      emu.counters.queue_waits++;
+      complete_oldest();
+    }
+    const size_t len = (color_size - done < (size_t)emu.max_transfer_sz) ? color_size - done : emu.max_transfer_sz;
+    Chunk c = {data + done, len, cmd, done == 0, done + len == color_size, -1};
+    c.index = trace(cmd, true, c.first, c.data, len);
+    emu.inflight.push_back(c);
+    emu.counters.transactions++;
+    done += len;
+  }
+  emu.counters.color_transfers++;
+  emu.counters.color_bytes += color_size;
+  return ESP_OK;
+}
+
+// Panel ops, as in esp_lcd
+
+esp_err_t esp_lcd_panel_reset(esp_lcd_panel_handle_t panel)
+{
+  return panel ? panel->reset(panel) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_lcd_panel_init(esp_lcd_panel_handle_t panel)
+{
+  return panel ? panel->init(panel) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_lcd_panel_del(esp_lcd_panel_handle_t panel)
+{
+  return panel ? panel->del(panel) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_lcd_panel_draw_bitmap(esp_lcd_panel_handle_t panel, int x_start, int y_start, int x_end, int y_end,
+                                    const void *color_data)
+{
+  return panel ? panel->draw_bitmap(panel, x_start, y_start, x_end, y_end, color_data) : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_lcd_panel_mirror(esp_lcd_panel_handle_t panel, bool mirror_x, bool mirror_y)
+{
+  return panel && panel->mirror ? panel->mirror(panel, mirror_x, mirror_y) : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_lcd_panel_swap_xy(esp_lcd_panel_handle_t panel, bool swap_axes)
+{
+  return panel && panel->swap_xy ? panel->swap_xy(panel, swap_axes) : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_lcd_panel_set_gap(esp_lcd_panel_handle_t panel, int x_gap, int y_gap)
+{
+  return panel && panel->set_gap ? panel->set_gap(panel, x_gap, y_gap) : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_lcd_panel_invert_color(esp_lcd_panel_handle_t panel, bool invert_color_data)
+{
+  return panel && panel->invert_color ? panel->invert_color(panel, invert_color_data) : ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_lcd_panel_disp_on_off(esp_lcd_panel_handle_t panel, bool on_off)
+{
+  return panel && panel->disp_on_off ? panel->disp_on_off(panel, on_off) : ESP_ERR_NOT_SUPPORTED;
+}
+}
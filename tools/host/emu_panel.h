@@ -0,0 +1,113 @@
+// Host emulator of the QSPI panel behind the esp_lcd panel IO, for the host tools
+//
+// The headers in tools/host stand in for the ESP-IDF, Arduino and FreeRTOS ones, so amoled.cpp and
+// low_level_amoled.c build unchanged on Linux. Their functions are implemented in emu_panel.cpp:
+// every esp_lcd_panel_io_tx_param/tx_color is decoded like the panel does (0x02 command or 0x32
+// pixel opcode, CASET/RASET/RAMWR/RAMWRC, the SH8601 and CO5300 init tables) into a 466x466
+// frame memory, and counted.
+//
+// Color transfers are queued like the SPI driver does: split in chunks of max_transfer_sz, at most
+// trans_queue_depth chunks in flight. A chunk reads its buffer only when it completes, so a buffer
+// reused before its transfer is done shows up as wrong pixels. Chunks complete when the driver has
+// to wait: a full queue, tx_param (which drains the queue first), an empty semaphore, vTaskDelay.
+// on_color_trans_done runs when the last chunk of a tx_color completes, as on the target.
+//
+// The controller ID is answered on the bit-banged read of register 0xDA done by read_lcd_id(), and
+// on the same read done by esp_amoled_read_id() with a 3-wire half-duplex SPI device.
+//
+// Time is the host clock plus the delays the driver asks for, which return at once (vTaskDelay,
+// esp_rom_delay_us, semaphore timeouts). After emu_te_start() the panel pulses its TE line once
+// per refresh period: the handler added on PIN_NUM_LCD_TE runs as soon as the driver looks at the
+// time or waits past a pulse, and sees the time of the pulse itself.
+//
+#ifndef EMU_PANEL_H
+#define EMU_PANEL_H
+
+#include <stdint.h>
+#include <vector>
+#include "board_config.h"
+
+struct EmuCounters
+{
+  long commands;         // commands of any kind, each one has a 32-bit command phase
+  long param_bytes;      // bytes sent after commands with tx_param
+  long color_bytes;      // pixel bytes sent with tx_color
+  long transactions;     // SPI transactions: one per tx_param, one per color chunk
+  long color_transfers;  // tx_color calls, each ends with one on_color_trans_done
+  long windows;          // CASET + RASET pairs
+  long ramwr, ramwrc;    // pixel writes started and continued
+  long unknown_commands; // commands the emulator does not know
+  long bad_opcodes;      // neither 0x02 with tx_param nor 0x32 with tx_color
+  long odd_windows;      // windows with an odd width or height, which the panel does not accept
+  long out_of_frame;     // pixels written outside of the visible frame
+  long bad_continue;     // RAMWRC without a memory write before it
+  long not_ready;        // pixels written while asleep, with the display off or not in RGB565
+  long bad_sequence;     // commands less than 5 ms after a sleep in/out, sleep in/outs less than 120 ms apart,
+                         // partial mode on before a partial area was set
+  long queue_waits;      // times the driver waited for a free slot in the transfer queue
+  long delay_ms;         // milliseconds passed in vTaskDelay
+  long id_reads;         // controller ID reads (register 0xDA)
+  long id_read_us;       // emulated time of the last one, from its first clock to its last bit
+};
+
+// One SPI transaction, in the order they reach the bus
+struct EmuTransaction
+{
+  uint8_t cmd;      // command code, the one of the tx_color call for every chunk of it
+  bool color;       // pixel chunk queued with tx_color, otherwise a polled tx_param
+  bool first;       // carries the command phase (every tx_param, the first chunk of a tx_color)
+  int bytes;        // bytes after the command phase
+  const void *data; // where the bytes were sent from
+  int queued;       // chunks in flight when this one was issued, itself included (a tx_param waits for them)
+  int after;        // the CPU waited for the end of this earlier transaction before issuing it (-1: none)
+  int64_t time_us;  // emulated time it was issued at
+};
+
+// State the init sequence leaves in the panel
+struct EmuPanelState
+{
+  bool awake;      // sleep out (0x11) received
+  bool display_on; // display on (0x29)
+  bool inverted;
+  uint8_t madctl, colmod, brightness;
+  bool te_on;      // tearing effect line on (0x35)
+  bool idle;       // idle mode (0x39)
+  bool partial;    // partial mode (0x12), rows partial_top to partial_bottom - 1 lit
+  int partial_top, partial_bottom;
+};
+
+// Start over with a panel of the given controller (SH8601_ID or CO5300_ID), like a power cycle:
+// the frame memory is filled with 0xDEAD, the bus and the counters are cleared
+void emu_reset(uint8_t controller_id);
+
+// Complete every transfer in flight
+void emu_complete_all();
+// Complete the oldest transfer in flight, false when there is none
+bool emu_complete_one();
+
+// Inside on_color_trans_done (flush-done callbacks included): index of the transaction completing
+int emu_completing();
+// The transactions issued from now on wait for the end of transaction `index` (the CPU waited for
+// it, e.g. for a buffer to come back). Semaphores and vTaskDelay record this on their own, waits on
+// a full queue and before tx_param are left to the timing model.
+void emu_depend(int index);
+
+// Frame memory as RGB565 values, DISPLAY_HEIGHT rows of DISPLAY_WIDTH pixels (visible area only)
+const uint16_t *emu_framebuffer();
+bool emu_dump_ppm(const char *path);
+
+const EmuCounters &emu_counters();
+const EmuPanelState &emu_panel_state();
+
+// Emulated time (esp_timer_get_time without delivering TE pulses)
+int64_t emu_time_us();
+// Pulse the TE line every period_us from now on (0: never), like a panel refreshing at 1e6/period_us Hz
+void emu_te_start(uint32_t period_us);
+// Row the panel reads at the given emulated time (amoled_te.h), -1 without TE pulses
+int emu_scan_line(int64_t time_us);
+
+// Transactions are only recorded after emu_record(true), for the timing model (wire_model.h)
+void emu_record(bool on);
+const std::vector<EmuTransaction> &emu_transactions();
+
+#endif
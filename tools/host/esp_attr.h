@@ -0,0 +1,5 @@
+// Host stand-in for the ESP-IDF header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#define IRAM_ATTR
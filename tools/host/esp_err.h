@@ -0,0 +1,20 @@
+// Host stand-in for the ESP-IDF header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+
+#define BIT(nr) (1UL << (nr))
+
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) (x)
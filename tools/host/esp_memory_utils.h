@@ -0,0 +1,16 @@
+// Host stand-in for the ESP-IDF header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// True inside a block allocated with MALLOC_CAP_DMA
+bool esp_ptr_dma_capable(const void *p);
+
+#ifdef __cplusplus
+}
+#endif
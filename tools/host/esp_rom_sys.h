@@ -0,0 +1,16 @@
+// Host stand-in for the ESP-IDF header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns at once, the emulated time (esp_timer_get_time) moves on
+void esp_rom_delay_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+// Host stand-in for the ESP-IDF header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Microseconds of emulated time: the host monotonic clock plus the time spent in vTaskDelay and
+// esp_rom_delay_us, which return at once
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
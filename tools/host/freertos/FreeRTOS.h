@@ -0,0 +1,31 @@
+// Host stand-in for the FreeRTOS header of the same name (see emu_panel.h)
+// There are no tasks: waiting lets the emulated bus complete the transfers in flight
+//
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR()
+#define configMAX_TASK_NAME_LEN 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One core, one task: the callbacks of the emulated bus are the ISRs
+static inline BaseType_t xPortGetCoreID(void) { return 0; }
+BaseType_t xPortInIsrContext(void);
+
+#ifdef __cplusplus
+}
+#endif
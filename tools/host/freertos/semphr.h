@@ -0,0 +1,24 @@
+// Host stand-in for the FreeRTOS header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct emu_semaphore *SemaphoreHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xSemaphoreCreateCounting(1, 0); }
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+// Taking an empty semaphore completes transfers in flight until it is given, or lets time pass
+// up to the next TE pulse (emu_te_start) when the wait has a timeout
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken);
+
+#ifdef __cplusplus
+}
+#endif
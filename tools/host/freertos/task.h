@@ -0,0 +1,21 @@
+// Host stand-in for the FreeRTOS header of the same name (see emu_panel.h)
+//
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct emu_task *TaskHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time passes: every transfer in flight completes
+void vTaskDelay(TickType_t ticks);
+// The one task of the host, named "main"
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
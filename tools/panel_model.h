@@ -0,0 +1,108 @@
+// Host model of the panel frame memory, for the host tools
+// CASET/RASET set the window, RAMWR writes from its top left corner and RAMWRC goes on from the
+// last pixel written. The address runs along the row, then down, and wraps to the top of the window.
+//
+#ifndef PANEL_MODEL_H
+#define PANEL_MODEL_H
+
+#include <stdint.h>
+#include <string.h>
+#include "board_config.h"
+
+struct PanelModel
+{
+  uint16_t fb[DISPLAY_HEIGHT][DISPLAY_WIDTH]; // pixels as sent (panel byte order)
+  int x_offset;                               // column of the first visible pixel (6 on the CO5300)
+  int xs, xe, ys, ye;                         // window, inclusive panel columns and rows
+  int cx, cy;                                 // next pixel
+  bool writing;                               // RAMWRC is only valid right after RAMWR or RAMWRC
+
+  // Counters
+  long commands;      // commands of any kind
+  long windows;       // CASET + RASET pairs
+  long ramwr, ramwrc; // pixel writes started and continued
+  long pixel_bytes;
+  long odd_windows;   // windows with an odd width or height, which this panel does not accept
+  long out_of_frame;  // pixels written outside of the frame
+  long bad_continue;  // RAMWRC without a memory write before it
+
+  void reset(int offset)
+  {
+    memset(this, 0, sizeof(*this));
+    x_offset = offset;
+    xe = DISPLAY_WIDTH - 1 + offset;
+    ye = DISPLAY_HEIGHT - 1;
+  }
+
+  void command(uint8_t cmd)
+  {
+    commands++;
+    if (cmd != 0x2C && cmd != 0x3C)
+      writing = false;
+  }
+
+  void caset(int x0, int x1)
+  {
+    command(0x2A);
+    xs = x0;
+    xe = x1;
+    windows++;
+    if ((xe - xs + 1) & 1)
+      odd_windows++;
+  }
+
+  void raset(int y0, int y1)
+  {
+    command(0x2B);
+    ys = y0;
+    ye = y1;
+    if ((ye - ys + 1) & 1)
+      odd_windows++;
+  }
+
+  void write(const uint16_t *px, long n, bool cont)
+  {
+    start(cont);
+    put(px, n);
+  }
+
+  // RAMWR or RAMWRC, the pixels follow with put()
+  void start(bool cont)
+  {
+    command(cont ? 0x3C : 0x2C);
+    if (cont)
+    {
+      ramwrc++;
+      if (!writing)
+        bad_continue++;
+    }
+    else
+    {
+      ramwr++;
+      cx = xs;
+      cy = ys;
+    }
+    writing = true;
+  }
+
+  void put(const uint16_t *px, long n)
+  {
+    pixel_bytes += n * 2;
+    for (long i = 0; i < n; i++)
+    {
+      const int x = cx - x_offset;
+      if (x >= 0 && x < DISPLAY_WIDTH && cy >= 0 && cy < DISPLAY_HEIGHT)
+        fb[cy][x] = px[i];
+      else
+        out_of_frame++;
+      if (++cx > xe)
+      {
+        cx = xs;
+        if (++cy > ye)
+          cy = ys;
+      }
+    }
+  }
+};
+
+#endif
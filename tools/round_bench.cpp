@@ -0,0 +1,130 @@
+// Host benchmark: bytes on the wire with and without round-panel span clipping
+//
+// Build and run from the sketch folder:
+//   g++ -std=c++14 -O2 -I. tools/round_bench.cpp -o round_bench && ./round_bench
+//
+// The compile-time span table is checked pixel by pixel against the circle first. Then each area
+// is pushed in strips like Amoled::drawArea does: as full rectangles, clipped to the widest span
+// of the strip, and clipped with 2-row windows where round_split() finds them cheaper.
+// Wire bytes are pixel bytes plus 20 command bytes (CASET, RASET, RAMWR) per window.
+//
+#include <stdio.h>
+#include "amoled_flush.h"
+#include "amoled_round.h"
+
+static const int CMD_BYTES = 20;
+
+typedef struct
+{
+  long pixel_bytes;
+  long windows;
+} Traffic;
+
+static Traffic push_area(int x, int y, int w, int h, int rows, int mode)
+{
+  Traffic t = {0, 0};
+  const int push_w = even_width(w);
+  for (int row = 0; row < h; row += rows)
+  {
+    int rows_this = (h - row < rows) ? h - row : rows;
+    int push_h = rows_this + (rows_this & 1);
+    int y_push = y + row;
+    if (push_h != rows_this && y_push + push_h > DISPLAY_HEIGHT)
+      y_push -= 1;
+    if (mode == 0)
+    {
+      t.pixel_bytes += (long)push_w * push_h * 2;
+      t.windows++;
+      continue;
+    }
+    int xa = x, xb = x + push_w;
+    if (!round_clip(y_push, push_h, xa, xb))
+      continue;
+    const int step = (mode == 2 && round_split(y_push, push_h, xa, xb)) ? 2 : push_h;
+    for (int wy = 0; wy < push_h; wy += step)
+    {
+      int wa = xa, wb = xb;
+      if (!round_clip(y_push + wy, step, wa, wb))
+        continue;
+      t.pixel_bytes += (long)(wb - wa) * step * 2;
+      t.windows++;
+    }
+  }
+  return t;
+}
+
+static int check_table()
+{
+  long visible = 0;
+  const int d = (DISPLAY_WIDTH < DISPLAY_HEIGHT) ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    const RoundSpan &s = round_spans.row[y];
+    if ((s.x0 & 1) || !(s.x1 & 1))
+    {
+      printf("row %d: span %d..%d is not even-aligned\n", y, s.x0, s.x1);
+      return 1;
+    }
+    for (int x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      const long dx = 2 * x - (DISPLAY_WIDTH - 1), dy = 2 * y - (DISPLAY_HEIGHT - 1);
+      const bool in_circle = dx * dx + dy * dy <= (long)d * d;
+      visible += in_circle;
+      if (in_circle && (x < s.x0 || x > s.x1))
+      {
+        printf("row %d: visible pixel %d outside span %d..%d\n", y, x, s.x0, s.x1);
+        return 1;
+      }
+    }
+  }
+  long spans = 0;
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+    spans += round_spans.row[y].x1 - round_spans.row[y].x0 + 1;
+  const long frame = (long)DISPLAY_WIDTH * DISPLAY_HEIGHT;
+  printf("Span table OK: %ld visible pixels, %ld in spans, %ld in the frame (%.1f%% invisible)\n\n",
+         visible, spans, frame, 100.0 * (frame - visible) / frame);
+  return 0;
+}
+
+int main()
+{
+  if (check_table())
+    return 1;
+
+  const struct
+  {
+    const char *name;
+    int x, y, w, h;
+  } areas[] = {
+      {"full frame", 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT},
+      {"top band 466x40", 0, 0, DISPLAY_WIDTH, 40},
+      {"middle band 466x40", 0, 212, DISPLAY_WIDTH, 40},
+      {"title label 260x44", 102, 66, 260, 44},
+      {"bubble at the rim 64x64", 380, 200, 64, 64},
+  };
+  const char *modes[] = {"rectangles", "clipped strips", "clipped + 2-row split"};
+  const int budgets[] = {STRIP_SIZE, 16 * 1024, 64 * 1024};
+
+  for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+  {
+    printf("Strip budget %d bytes, window overhead %d bytes\n", budgets[b], WINDOW_OVERHEAD_BYTES);
+    for (size_t i = 0; i < sizeof(areas) / sizeof(areas[0]); i++)
+    {
+      const int rows = strip_rows(even_width(areas[i].w), budgets[b]);
+      printf("  %s\n", areas[i].name);
+      long base = 0;
+      for (int m = 0; m < 3; m++)
+      {
+        Traffic t = push_area(areas[i].x, areas[i].y, areas[i].w, areas[i].h, rows, m);
+        long wire = t.pixel_bytes + t.windows * CMD_BYTES;
+        long cost = t.pixel_bytes + t.windows * (long)WINDOW_OVERHEAD_BYTES;
+        if (m == 0)
+          base = wire;
+        printf("    %-22s %5ld windows %8ld wire bytes (%5.1f%% saved) %8ld cost bytes\n",
+               modes[m], t.windows, wire, 100.0 * (base - wire) / base, cost);
+      }
+    }
+    printf("\n");
+  }
+  return 0;
+}
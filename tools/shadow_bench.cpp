@@ -0,0 +1,175 @@
+// Host benchmark: pixel bytes sent with the shadow framebuffer, for typical LVGL redraws
+//
+// Build and run from the sketch folder, once per shadow mode:
+//   g++ -std=c++14 -O2 -I. -DSHADOW_FRAMEBUFFER=1 tools/shadow_bench.cpp -o shadow_bench && ./shadow_bench
+//   g++ -std=c++14 -O2 -I. -DSHADOW_FRAMEBUFFER=2 tools/shadow_bench.cpp -o shadow_bench && ./shadow_bench
+//
+// Each scenario redraws areas of a 466x466 frame the way LVGL invalidates them (whole bounding
+// boxes, even-aligned by the rounder). Areas are pushed in clipped strips like Amoled::drawArea,
+// every window the shadow lets through is written to a simulated panel, and the panel is checked
+// against the frame after each flush.
+//
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "amoled_flush.h"
+#include "amoled_round.h"
+#include "amoled_shadow.h"
+
+static uint16_t frame[DISPLAY_HEIGHT][DISPLAY_WIDTH]; // what LVGL rendered
+static uint16_t panel[DISPLAY_HEIGHT][DISPLAY_WIDTH]; // what the panel holds
+
+typedef struct
+{
+  long sent;      // pixel bytes sent
+  long unchanged; // pixel bytes left out by the shadow
+  long windows;
+} Traffic;
+
+static void draw_background(int x0, int y0, int w, int h)
+{
+  for (int y = y0; y < y0 + h; y++)
+    for (int x = x0; x < x0 + w; x++)
+      frame[y][x] = (uint16_t)(((y * 31 / DISPLAY_HEIGHT) << 11) | (x * 63 / DISPLAY_WIDTH) << 5);
+}
+
+static void draw_bubble(int cx, int cy, int r, uint16_t c)
+{
+  for (int y = cy - r; y <= cy + r; y++)
+    for (int x = cx - r; x <= cx + r; x++)
+      if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r)
+        frame[y][x] = c;
+}
+
+static void draw_label(int x, int y, int w, int h, unsigned seed)
+{
+  for (int r = 0; r < h; r++)
+    for (int i = 0; i < w; i++)
+      frame[y + r][x + i] = ((i / 6 + seed) * 2654435761u >> 13) & 1 ? 0xFFFF : 0x0000;
+}
+
+// Flush frame[y..y+h-1][x..x+w-1] (even position and size) like Amoled::drawArea
+static void flush(AmoledShadow &shadow, bool use_shadow, int x, int y, int w, int h, Traffic &t)
+{
+  const int rows = strip_rows(w, STRIP_SIZE);
+  for (int row = 0; row < h; row += rows)
+  {
+    const int push_h = (h - row < rows) ? h - row : rows;
+    const int y_push = y + row;
+    int wa = x, wb = x + w;
+    if (!round_clip(y_push, push_h, wa, wb))
+      continue;
+    auto emit = [&](int ga, int gb, int gy, int gh)
+    {
+      for (int r = gy; r < gy + gh; r++)
+        memcpy(&panel[y_push + r][ga], &frame[y_push + r][ga], (gb - ga) * sizeof(uint16_t));
+      t.sent += (long)(gb - ga) * gh * 2;
+      t.windows++;
+      return true;
+    };
+    if (!use_shadow)
+    {
+      emit(wa, wb, 0, push_h);
+      continue;
+    }
+    t.unchanged += 2 * shadow_diff_window(
+                           shadow, y_push, push_h, wa, wb, wb - wa,
+                           [&](int r)
+                           { return &frame[y_push + r][wa]; },
+                           emit);
+  }
+}
+
+static int check_panel()
+{
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    int xa = 0, xb = DISPLAY_WIDTH;
+    if (!round_clip(y, 1, xa, xb))
+      continue;
+    for (int x = xa; x < xb; x++)
+      if (panel[y][x] != frame[y][x])
+      {
+        printf("panel differs from the frame at %d,%d\n", x, y);
+        return 1;
+      }
+  }
+  return 0;
+}
+
+int main()
+{
+  void *mem = malloc(shadow_bytes());
+  AmoledShadow shadow;
+  printf("SHADOW_FRAMEBUFFER=%d, %zu bytes of shadow, window overhead %d bytes\n\n",
+         SHADOW_FRAMEBUFFER, shadow_bytes(), WINDOW_OVERHEAD_BYTES);
+
+  for (int use_shadow = 0; use_shadow < 2; use_shadow++)
+  {
+    printf("%s\n", use_shadow ? "with the shadow framebuffer" : "without");
+    shadow_init(shadow, mem);
+
+    // First full frame, every pixel is sent once (the shadow content is unknown or black)
+    Traffic t = {0, 0, 0};
+    draw_background(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    shadow_write(shadow, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, NULL, 0, 0);
+    memset(panel, 0, sizeof(panel));
+    flush(shadow, use_shadow, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, t);
+    if (check_panel())
+      return 1;
+
+    const struct
+    {
+      const char *name;
+      int kind;
+    } scenarios[] = {
+        {"label set to the same text x60", 0},
+        {"label text changes x60", 1},
+        {"bubble moves 3 px x60", 2},
+        {"full frame, one bubble moves x60", 3},
+    };
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+    {
+      Traffic st = {0, 0, 0};
+      double ns = 0;
+      for (int i = 0; i < 60; i++)
+      {
+        int x = 102, y = 66, w = 260, h = 44;
+        if (scenarios[s].kind == 1)
+          draw_label(x, y, w, h, i);
+        else if (scenarios[s].kind == 0)
+          draw_label(x, y, w, h, 7);
+        else
+        {
+          const int cx = 150 + 3 * i, cy = 240;
+          // LVGL invalidates the old and the new bounding box, merged into one area
+          draw_background(cx - 3 - 30, cy - 30, 61, 61);
+          draw_bubble(cx, cy, 30, 0xF800);
+          x = (cx - 3 - 30) & ~1;
+          y = (cy - 30) & ~1;
+          w = 66 + 4;
+          h = 62;
+          if (scenarios[s].kind == 3)
+          {
+            x = y = 0;
+            w = DISPLAY_WIDTH;
+            h = DISPLAY_HEIGHT;
+          }
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        flush(shadow, use_shadow, x, y, w, h, st);
+        auto t1 = std::chrono::steady_clock::now();
+        ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        if (check_panel())
+          return 1;
+      }
+      printf("  %-34s %9ld bytes sent %9ld unchanged %5ld windows %8.1f us/flush (host)\n",
+             scenarios[s].name, st.sent, st.unchanged, st.windows, ns / 60 / 1000.0);
+    }
+    printf("\n");
+  }
+  free(mem);
+  printf("Panel matched the frame after every flush\n");
+  return 0;
+}
@@ -0,0 +1,99 @@
+// Host microbenchmark: staging 466-pixel rows, memcpy-then-swap vs the fused staging kernels
+//
+// Build and run from the sketch folder:
+//   g++ -std=c++11 -O2 -I. tools/stage_bench.cpp -o stage_bench && ./stage_bench [iterations] [rounds]
+//
+// Each kernel stages a full 466x466 frame row by row into an even-width strip, for an even
+// source width (466) and an odd one (465, padded to 466), and its output is checked against
+// the reference two-pass version. The kernels take turns over several rounds and the fastest
+// round of each is kept, other processes on the host only ever make a round slower.
+//
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "amoled_flush.h"
+#include "amoled_stage.h"
+
+typedef void (*StageFn)(uint16_t *dst, const uint16_t *src, int w, int push_w);
+
+// What drawArea did before the fused kernel: copy, then pad, then a second pass to swap
+static void memcpy_then_swap(uint16_t *dst, const uint16_t *src, int w, int push_w)
+{
+  memcpy(dst, src, w * sizeof(uint16_t));
+  if (push_w != w)
+    dst[w] = src[w - 1];
+  for (int i = 0; i < push_w; i++)
+    dst[i] = (uint16_t)((dst[i] << 8) | (dst[i] >> 8));
+}
+
+static const struct
+{
+  const char *name;
+  StageFn fn;
+} kernels[] = {
+    {"memcpy + swap (2 passes)", memcpy_then_swap},
+    {"fused scalar", stage_row_scalar},
+    {"fused SWAR32", stage_row_swar32},
+    {"fused SWAR64", stage_row_swar64},
+};
+
+int main(int argc, char **argv)
+{
+  const int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+  const int rounds = (argc > 2) ? atoi(argv[2]) : 15;
+  const int h = DISPLAY_HEIGHT;
+  uint16_t *src = (uint16_t *)malloc(DISPLAY_WIDTH * h * sizeof(uint16_t));
+  uint16_t *ref = (uint16_t *)malloc((DISPLAY_WIDTH + 1) * sizeof(uint16_t));
+  uint16_t *dst = (uint16_t *)malloc((DISPLAY_WIDTH + 1) * h * sizeof(uint16_t));
+  for (int i = 0; i < DISPLAY_WIDTH * h; i++)
+    src[i] = (uint16_t)(i * 2654435761u >> 7);
+
+  printf("AMOLED_SWAP_BYTES=%d, default kernel %d, best of %d rounds of %d frames of %d rows\n\n",
+         AMOLED_SWAP_BYTES, AMOLED_STAGE_KERNEL, rounds, iterations, h);
+  const int kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+  const int widths[] = {DISPLAY_WIDTH, DISPLAY_WIDTH - 1};
+  for (size_t wi = 0; wi < sizeof(widths) / sizeof(widths[0]); wi++)
+  {
+    const int w = widths[wi];
+    const int push_w = even_width(w);
+    printf("source width %d -> %d\n", w, push_w);
+    // Correctness against the two-pass reference, on every row alignment
+    for (int k = 0; k < kernel_count; k++)
+      for (int y = 0; y < h; y++)
+      {
+        memcpy_then_swap(ref, src + y * w, w, push_w);
+        kernels[k].fn(dst, src + y * w, w, push_w);
+        if (memcmp(ref, dst, push_w * sizeof(uint16_t)) != 0)
+        {
+          printf("  %-26s MISMATCH on row %d\n", kernels[k].name, y);
+          return 1;
+        }
+      }
+
+    double best_ns[sizeof(kernels) / sizeof(kernels[0])];
+    for (int r = 0; r < rounds; r++)
+      for (int k = 0; k < kernel_count; k++)
+      {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++)
+        {
+          for (int y = 0; y < h; y++)
+            kernels[k].fn(dst + y * push_w, src + y * w, w, push_w);
+          __asm__ __volatile__("" : : "r"(dst) : "memory");
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double ns_row = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)iterations * h);
+        if (r == 0 || ns_row < best_ns[k])
+          best_ns[k] = ns_row;
+      }
+    for (int k = 0; k < kernel_count; k++)
+      printf("  %-26s %8.1f ns/row %8.1f us/frame %6.2fx\n",
+             kernels[k].name, best_ns[k], best_ns[k] * h / 1000.0, best_ns[0] / best_ns[k]);
+    printf("\n");
+  }
+  free(src);
+  free(ref);
+  free(dst);
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Host check: strips sent with memory-write-continue land where the plain windows put them
+//
+// Build and run from the sketch folder:
+//   g++ -std=c++14 -O2 -I. -Itools tools/stream_check.cpp -o stream_check && ./stream_check
+//
+// Areas are pushed in strips like Amoled::drawArea (STRIP_SIZE budget, round clipping, filler
+// row on odd heights) and each strip goes through the same window logic as Amoled::pushToPanel,
+// once with a window per strip and once with STREAM_WRITES continuation. Both panel models must
+// end up with the reference frame, and the command counts are compared.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include "amoled_flush.h"
+#include "amoled_round.h"
+#include "panel_model.h"
+
+static uint16_t frame[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+static uint16_t strip[STRIP_SIZE / 2 + DISPLAY_WIDTH * 2];
+
+struct Pusher
+{
+  PanelModel *panel;
+  bool streaming;
+  StreamWindow stream;
+  int bottom;
+
+  void push(int x, int y, const uint16_t *buf, int w, int h)
+  {
+    const bool cont = streaming && stream_continues(stream, x, y, w, h);
+    if (!cont)
+    {
+      const int end_y = streaming ? stream_window_end(y, h, bottom) : y + h;
+      panel->caset(x + panel->x_offset, x + w - 1 + panel->x_offset);
+      panel->raset(y, end_y - 1);
+      stream.x = x;
+      stream.w = w;
+      stream.end_y = end_y;
+    }
+    panel->write(buf, (long)w * h, cont);
+    stream.next_y = y + h;
+  }
+
+  // Send frame[y1..y1+h-1][x1..x1+w-1] like Amoled::drawArea (staged path)
+  void area(int x1, int y1, int w, int h)
+  {
+    const int push_w = even_width(w);
+    const int rows = strip_rows(push_w, STRIP_SIZE);
+    bottom = y1 + h + ((h & 1) && y1 + h < DISPLAY_HEIGHT ? 1 : 0);
+    for (int row = 0; row < h; row += rows)
+    {
+      const int rows_this = (h - row < rows) ? h - row : rows;
+      const int push_h = rows_this + (rows_this & 1);
+      int y_push = y1 + row, lead = 0;
+      if (push_h != rows_this && y_push + push_h > DISPLAY_HEIGHT)
+      {
+        y_push -= 1;
+        lead = 1;
+      }
+      int xa = x1, xb = x1 + push_w;
+      if (!round_clip(y_push, push_h, xa, xb))
+        continue;
+      const int cols = xb - xa;
+      for (int r = 0; r < push_h; r++)
+      {
+        int src = row + r - lead;
+        src = (src < 0) ? 0 : (src > h - 1) ? h - 1 : src;
+        for (int i = 0; i < cols; i++)
+        {
+          const int x = (xa + i < x1 + w) ? xa + i : x1 + w - 1;
+          strip[r * cols + i] = frame[y1 + src][x];
+        }
+      }
+      push(xa, y_push, strip, cols, push_h);
+    }
+  }
+};
+
+// An odd area also overwrites the column on its right and the row below with copies of its edges
+static void expect_padding(int x1, int y1, int w, int h)
+{
+  if ((w & 1) && x1 + w < DISPLAY_WIDTH)
+    for (int y = y1; y < y1 + h; y++)
+      frame[y][x1 + w] = frame[y][x1 + w - 1];
+  if ((h & 1) && y1 + h < DISPLAY_HEIGHT)
+    for (int x = x1; x < x1 + even_width(w) && x < DISPLAY_WIDTH; x++)
+      frame[y1 + h][x] = frame[y1 + h - 1][x];
+}
+
+static int compare(const PanelModel &p, const char *name)
+{
+  for (int y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    int xa = 0, xb = DISPLAY_WIDTH;
+    if (!round_clip(y, 1, xa, xb))
+      continue;
+    for (int x = xa; x < xb; x++)
+      if (p.fb[y][x] != frame[y][x])
+      {
+        printf("%s: pixel %d,%d is %04X instead of %04X\n", name, x, y, p.fb[y][x], frame[y][x]);
+        return 1;
+      }
+  }
+  if (p.odd_windows || p.out_of_frame || p.bad_continue)
+  {
+    printf("%s: %ld odd windows, %ld pixels out of the frame, %ld bad RAMWRC\n", name, p.odd_windows,
+           p.out_of_frame, p.bad_continue);
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  static PanelModel plain, streamed;
+  const struct
+  {
+    const char *name;
+    int x, y, w, h;
+  } areas[] = {
+      {"full frame", 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT},
+      {"LVGL band 466x40", 0, 200, DISPLAY_WIDTH, 40},
+      {"label inside the circle 120x30", 172, 120, 120, 30},
+      {"odd height on the bottom edge", 180, 401, 100, 65},
+      {"odd width and height", 150, 150, 101, 77},
+      {"bubble 64x64", 200, 200, 64, 64},
+  };
+  const int offsets[] = {0, 6};
+
+  for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++)
+  {
+    printf("X offset %d\n", offsets[o]);
+    printf("  %-32s %14s %14s\n", "", "window/strip", "STREAM_WRITES");
+    plain.reset(offsets[o]);
+    streamed.reset(offsets[o]);
+    Pusher a = {&plain, false, {}, 0};
+    Pusher b = {&streamed, true, {}, 0};
+    for (size_t i = 0; i < sizeof(areas) / sizeof(areas[0]); i++)
+    {
+      for (int y = 0; y < DISPLAY_HEIGHT; y++)
+        for (int x = 0; x < DISPLAY_WIDTH; x++)
+          frame[y][x] = (uint16_t)rand();
+      // The whole frame is sent first, then the area is redrawn
+      const long c0 = plain.commands, c1 = streamed.commands;
+      a.area(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+      b.area(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+      for (int y = areas[i].y; y < areas[i].y + areas[i].h; y++)
+        for (int x = areas[i].x; x < areas[i].x + areas[i].w; x++)
+          frame[y][x] = (uint16_t)rand();
+      expect_padding(areas[i].x, areas[i].y, areas[i].w, areas[i].h);
+      const long f0 = plain.commands, f1 = streamed.commands;
+      a.area(areas[i].x, areas[i].y, areas[i].w, areas[i].h);
+      b.area(areas[i].x, areas[i].y, areas[i].w, areas[i].h);
+      if (compare(plain, "window/strip") || compare(streamed, "STREAM_WRITES"))
+        return 1;
+      printf("  %-32s %5ld commands %5ld commands (full frame %ld -> %ld)\n", areas[i].name,
+             plain.commands - f0, streamed.commands - f1, f0 - c0, f1 - c1);
+    }
+    printf("  totals: %ld windows %ld RAMWR vs %ld windows %ld RAMWR %ld RAMWRC\n\n", plain.windows,
+           plain.ramwr, streamed.windows, streamed.ramwr, streamed.ramwrc);
+  }
+  printf("Both panels match the frame after every area\n");
+  return 0;
+}
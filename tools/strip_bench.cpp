@@ -0,0 +1,63 @@
+// Host benchmark: panel transactions and command overhead per frame, 2-row pushes vs strip batching
+//
+// Build and run from the sketch folder:
+//   g++ -std=c++11 -O2 -I. tools/strip_bench.cpp -o strip_bench && ./strip_bench [setup_us]
+//
+// Every transaction costs a CASET, a RASET and the RAMWR header. In QSPI mode each command is
+// a 32-bit single-line word (opcode, command, padding) followed by its parameters on one line.
+// setup_us is the software/DMA setup time paid per polled command (default 8 us).
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include "amoled_flush.h"
+
+static const int CMD_BYTES = 4 + 4 + 4 + 4 + 4; // CASET + 4 params, RASET + 4 params, RAMWR header
+static const int CMDS_PER_TRANSACTION = 3;
+
+typedef struct
+{
+  const char *name;
+  int w, h, count; // area size and number of such areas per frame
+} Scenario;
+
+static const Scenario scenarios[] = {
+    {"full frame 466x466", DISPLAY_WIDTH, DISPLAY_HEIGHT, 1},
+    {"bubble move (2x 64x64)", 64, 64, 2},
+    {"angle labels (2x 110x38)", 110, 38, 2},
+    {"title label 260x44", 260, 44, 1},
+};
+
+static void report(const char *mode, int transactions, double setup_us)
+{
+  const double bus_hz = (double)(BUS_SPEED);
+  double cmd_bytes = (double)transactions * CMD_BYTES;
+  double cmd_us = cmd_bytes * 8.0 / bus_hz * 1e6 + (double)transactions * CMDS_PER_TRANSACTION * setup_us;
+  printf("  %-22s %8d transactions %9.0f cmd bytes %10.1f us command overhead\n",
+         mode, transactions, cmd_bytes, cmd_us);
+}
+
+int main(int argc, char **argv)
+{
+  double setup_us = (argc > 1) ? atof(argv[1]) : 8.0;
+  const int budgets[] = {TRANSFER_SIZE, 8 * 1024, 16 * 1024, 32 * 1024};
+
+  printf("Bus %d MHz, STRIP_SIZE %d bytes, setup %.1f us per command\n\n",
+         (int)((BUS_SPEED) / 1000000), STRIP_SIZE, setup_us);
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+  {
+    const Scenario &sc = scenarios[i];
+    const int push_w = even_width(sc.w);
+    const int h = sc.h + (sc.h & 1);
+    printf("%s\n", sc.name);
+    report("2 rows (legacy)", strip_count(h, 2) * sc.count, setup_us);
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+    {
+      char mode[32];
+      int rows = strip_rows(push_w, budgets[b]);
+      snprintf(mode, sizeof(mode), "%d B (%d rows)", budgets[b], rows);
+      report(mode, strip_count(h, rows) * sc.count, setup_us);
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Host check: TE-synchronised flushes (TE_SYNC 2) against the panel emulator pulsing its TE line
+//
+// Build and run from the sketch folder (any free pin stands for the TE line):
+//   gcc -c -std=gnu11 -DTE_SYNC=2 -DPIN_NUM_LCD_TE=18 -I. -Itools/host low_level_amoled.c -o low_level_amoled.o &&
+//   g++ -std=gnu++17 -O2 -DTE_SYNC=2 -DPIN_NUM_LCD_TE=18 -I. -Itools -Itools/host tools/te_check.cpp
+//       tools/host/emu_panel.cpp amoled.cpp low_level_amoled.o -o te_check && ./te_check
+//
+// For both controllers, with the panel refreshing at 60 Hz: begin() must turn TE on,
+// waitTearingEffect() must return once per refresh and the measured period must match. Then
+// areas are flushed at random times of the refresh, and no transfer of an area may be issued
+// while the scan line is on its rows.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include "amoled.h"
+#include "amoled_te.h"
+#include "emu_panel.h"
+
+#if TE_SYNC < 2 || PIN_NUM_LCD_TE < 0
+#error "build with -DTE_SYNC=2 and a TE pin, see above"
+#endif
+
+static const uint32_t PERIOD_US = 16667; // 60 Hz
+
+static void on_flush_done(void *) {}
+
+static bool run(uint8_t id, const char *name)
+{
+  printf("%s\n", name);
+  emu_reset(id);
+  emu_te_start(PERIOD_US);
+  Amoled amoled;
+  if (!amoled.begin() || !emu_panel_state().te_on)
+  {
+    printf("  begin() failed or left TE off\n");
+    return false;
+  }
+  amoled.setFlushDoneCallback(on_flush_done, NULL);
+
+  // One pulse per refresh
+  int64_t last = 0;
+  for (int i = 0; i < 20; i++)
+  {
+    if (!amoled.waitTearingEffect(100))
+    {
+      printf("  no TE pulse\n");
+      return false;
+    }
+    const int64_t now = emu_time_us();
+    if (i > 1 && (now - last < PERIOD_US * 9 / 10 || now - last > PERIOD_US * 11 / 10))
+    {
+      printf("  waitTearingEffect returned %lld us after the previous one\n", (long long)(now - last));
+      return false;
+    }
+    last = now;
+  }
+  const uint32_t period = amoled.refreshPeriod();
+  printf("  refresh period %u us (panel %u us)\n", (unsigned)period, (unsigned)PERIOD_US);
+  if (period < PERIOD_US * 49 / 50 || period > PERIOD_US * 51 / 50)
+    return false;
+
+  // Areas at random times: the scan line must never be on the rows being written
+  static uint16_t buf[DISPLAY_WIDTH * 40];
+  for (int i = 0; i < DISPLAY_WIDTH * 40; i++)
+    buf[i] = (uint16_t)rand();
+  emu_record(true);
+  int held = 0, crossed = 0;
+  const int n = 300;
+  for (int i = 0; i < n; i++)
+  {
+    const bool band = (i & 1);
+    const int w = band ? DISPLAY_WIDTH : 64, h = band ? 40 : 64;
+    const int x = band ? 0 : 120 + rand() % 160;
+    const int y = 20 + rand() % (DISPLAY_HEIGHT - 40 - h);
+    vTaskDelay(rand() % 17); // anywhere in the refresh
+    const int line = emu_scan_line(emu_time_us());
+    if (te_wait_us(line, y - 1, y + h + 1, PERIOD_US))
+      held++;
+    const size_t first = emu_transactions().size();
+    amoled.drawArea(x, y, x + w - 1, y + h - 1, buf);
+    emu_complete_all();
+    const std::vector<EmuTransaction> &t = emu_transactions();
+    for (size_t k = first; k < t.size(); k++)
+    {
+      const int scan = emu_scan_line(t[k].time_us);
+      if (scan >= y && scan < y + h)
+      {
+        crossed++;
+        break;
+      }
+    }
+  }
+  emu_record(false);
+  printf("  %d areas, %d held back for the scan line, %d written under it\n", n, held, crossed);
+  return held > 0 && crossed == 0;
+}
+
+int main()
+{
+  if (!run(SH8601_ID, SH8601_NAME) || !run(CO5300_ID, CO5300_NAME))
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("Areas are never written under the scan line\n");
+  return 0;
+}
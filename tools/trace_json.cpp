@@ -0,0 +1,297 @@
+// Host tool: event trace frames (trace.h) to a Chrome trace, for chrome://tracing or ui.perfetto.dev
+//
+// Build from the sketch folder:
+//   gcc -c -std=gnu11 -DTRACE_EVENTS=1024 -I. -Itools/host low_level_amoled.c -o low_level_amoled.o &&
+//   gcc -c -std=gnu11 -DTRACE_EVENTS=1024 -I. -Itools/host trace.c -o trace.o &&
+//   g++ -std=gnu++17 -O2 -DTRACE_EVENTS=1024 -I. -Itools -Itools/host tools/trace_json.cpp tools/host/emu_panel.cpp
+//       amoled.cpp low_level_amoled.o trace.o -o trace_json
+//
+//   ./trace_json capture.bin > trace.json
+// converts a capture of the serial port of a board built with TRACE_EVENTS: the frames are picked
+// out of the text around them, a frame cut or damaged in the capture is left out.
+//
+//   ./trace_json
+// checks the trace itself: the driver draws on the panel emulator with the events of drawArea and
+// of the transfer-done ISR traced, the ring is drained in small frames mixed with text, and every
+// event must come back from the conversion, begins matched with ends.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "amoled.h"
+#include "emu_panel.h"
+#include "trace.h"
+
+struct Event
+{
+  char type;
+  uint8_t thread;
+  std::string name;
+  uint64_t ts_us; // unwrapped
+};
+
+struct Trace
+{
+  std::vector<Event> events;
+  std::map<int, std::string> threads;
+  long frames = 0, bad_frames = 0, lost = 0;
+};
+
+static uint32_t get32(const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Records of one frame, false when it does not parse to its end
+static bool parse_frame(const uint8_t *p, size_t n, Trace &t, uint64_t &last_ts)
+{
+  std::map<uint32_t, std::string> names;
+  std::vector<Event> events;
+  std::map<int, std::string> threads;
+  long lost = 0;
+  size_t i = 0;
+  while (i < n)
+  {
+    const uint8_t type = p[i++];
+    switch (type)
+    {
+    case TRACE_RECORD_BEGIN:
+    case TRACE_RECORD_END:
+    case TRACE_RECORD_INSTANT:
+    {
+      if (n - i < 9)
+        return false;
+      const auto name = names.find(get32(p + i + 1));
+      if (name == names.end())
+        return false;
+      // 32-bit timestamps wrap every 71 minutes
+      const uint32_t ts = get32(p + i + 5);
+      uint64_t full = (last_ts & ~0xFFFFFFFFull) | ts;
+      if (full + 0x80000000ull < last_ts)
+        full += 0x100000000ull;
+      events.push_back({(char)type, p[i], name->second, full});
+      i += 9;
+      break;
+    }
+    case TRACE_RECORD_NAME:
+    case TRACE_RECORD_THREAD:
+    {
+      const size_t head = (type == TRACE_RECORD_NAME) ? 5 : 2;
+      if (n - i < head || n - i - head < p[i + head - 1])
+        return false;
+      const std::string s((const char *)p + i + head, p[i + head - 1]);
+      if (type == TRACE_RECORD_NAME)
+        names[get32(p + i)] = s;
+      else
+        threads[p[i]] = s;
+      i += head + s.size();
+      break;
+    }
+    case TRACE_RECORD_LOST:
+      if (n - i < 4)
+        return false;
+      lost += get32(p + i);
+      i += 4;
+      break;
+    default:
+      return false;
+    }
+  }
+  for (const Event &e : events)
+    last_ts = std::max(last_ts, e.ts_us);
+  t.events.insert(t.events.end(), events.begin(), events.end());
+  for (const auto &th : threads)
+    t.threads[th.first] = th.second;
+  t.lost += lost;
+  t.frames++;
+  return true;
+}
+
+static Trace parse(const std::vector<uint8_t> &in)
+{
+  Trace t;
+  uint64_t last_ts = 0;
+  for (size_t i = 0; i + TRACE_FRAME_HEADER <= in.size();)
+  {
+    if (memcmp(&in[i], TRACE_FRAME_MAGIC, 4))
+    {
+      i++;
+      continue;
+    }
+    const size_t n = in[i + 4] | in[i + 5] << 8;
+    if (i + TRACE_FRAME_HEADER + n > in.size() || !parse_frame(&in[i + TRACE_FRAME_HEADER], n, t, last_ts))
+    {
+      t.bad_frames++;
+      i++;
+      continue;
+    }
+    i += TRACE_FRAME_HEADER + n;
+  }
+  return t;
+}
+
+// The tasks keep their number, the ISRs are one thread per core
+static int tid(uint8_t thread)
+{
+  return (thread & 0x7F) == TRACE_ISR ? 1000 + (thread >> 7) : (thread & 0x7F);
+}
+
+static void write_json(const Trace &t, FILE *f)
+{
+  fprintf(f, "{\"traceEvents\":[\n");
+  std::map<int, std::string> names;
+  for (const Event &e : t.events)
+    if (!names.count(tid(e.thread)))
+    {
+      const int id = tid(e.thread);
+      const auto th = t.threads.find(e.thread & 0x7F);
+      char name[48];
+      if (id >= 1000)
+        snprintf(name, sizeof(name), "ISR core %d", id - 1000);
+      else if (th != t.threads.end())
+        snprintf(name, sizeof(name), "%s", th->second.c_str());
+      else
+        snprintf(name, sizeof(name), "task %d", id);
+      names[id] = name;
+      fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", id,
+              name);
+    }
+  for (size_t i = 0; i < t.events.size(); i++)
+  {
+    const Event &e = t.events[i];
+    fprintf(f, "{\"name\":\"%s\",\"ph\":\"%c\",%s\"ts\":%llu,\"pid\":1,\"tid\":%d,\"args\":{\"core\":%d}}%s\n",
+            e.name.c_str(), e.type, e.type == TRACE_RECORD_INSTANT ? "\"s\":\"t\"," : "",
+            (unsigned long long)e.ts_us, tid(e.thread), e.thread >> 7, i + 1 < t.events.size() ? "," : "");
+  }
+  fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+static int convert(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+  {
+    perror(path);
+    return 1;
+  }
+  std::vector<uint8_t> in;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    in.insert(in.end(), buf, buf + n);
+  fclose(f);
+  const Trace t = parse(in);
+  write_json(t, stdout);
+  fprintf(stderr, "%ld frames, %zu events, %ld lost, %ld frames left out\n", t.frames, t.events.size(), t.lost,
+          t.bad_frames);
+  return 0;
+}
+
+// The serial output of a board: log lines, then a frame whenever the ring is drained
+static void drain(std::vector<uint8_t> &out, size_t frame_size)
+{
+  static const char log[] = "I (1234) amoled: some log line\r\n";
+  out.insert(out.end(), log, log + sizeof(log) - 1);
+  std::vector<uint8_t> buf(frame_size);
+  size_t n;
+  while ((n = trace_drain(buf.data(), buf.size())) > 0)
+    out.insert(out.end(), buf.begin(), buf.begin() + n);
+}
+
+static bool check()
+{
+  emu_reset(SH8601_ID);
+  Amoled amoled;
+  if (!amoled.begin())
+    return false;
+  static volatile long isr_done = 0;
+  amoled.setFlushDoneCallback([](void *) { TRACE_INSTANT("flush done"); isr_done++; }, NULL);
+  std::vector<uint8_t> capture;
+  drain(capture, 256);
+  static uint16_t band[DISPLAY_WIDTH * 40];
+  const int flushes = 200;
+  for (int i = 0; i < flushes; i++)
+  {
+    TRACE_SCOPE("frame");
+    const int y = (i * 40) % (DISPLAY_HEIGHT - 40) & ~1;
+    amoled.drawArea(0, y, DISPLAY_WIDTH - 1, y + 39, band);
+    if (i % 16 == 15)
+      drain(capture, 200); // frames of a few events, cut between the records
+  }
+  emu_complete_all();
+  drain(capture, 200);
+  // More events than the ring holds: the oldest ones are reported lost
+  for (int i = 0; i < TRACE_EVENTS + 100; i++)
+    TRACE_INSTANT("overflow");
+  drain(capture, 1024);
+  // A frame damaged on the line, then one cut by the end of the capture
+  std::vector<uint8_t> tail(64);
+  TRACE_INSTANT("damaged");
+  const size_t n = trace_drain(tail.data(), tail.size());
+  tail[TRACE_FRAME_HEADER] = 'X';
+  capture.insert(capture.end(), tail.begin(), tail.begin() + n);
+  TRACE_INSTANT("cut");
+  const size_t m = trace_drain(tail.data(), tail.size());
+  capture.insert(capture.end(), tail.begin(), tail.begin() + m - 2);
+
+  const Trace t = parse(capture);
+  long begins = 0, ends = 0, draws = 0, done = 0, open = 0, mismatched = 0, overflow = 0;
+  std::vector<std::string> stack;
+  for (const Event &e : t.events)
+  {
+    if (e.type == TRACE_RECORD_BEGIN)
+    {
+      begins++;
+      draws += e.name == "drawArea";
+      stack.push_back(e.name);
+    }
+    else if (e.type == TRACE_RECORD_END)
+    {
+      ends++;
+      mismatched += stack.empty() || stack.back() != e.name;
+      if (!stack.empty())
+        stack.pop_back();
+    }
+    else
+    {
+      done += e.name == "flush done" && (e.thread & 0x7F) == TRACE_ISR;
+      overflow += e.name == "overflow";
+    }
+  }
+  open = stack.size();
+  printf("%ld frames (%ld left out), %zu events: %ld begins, %ld ends, %ld flush done from the ISR, %ld lost\n",
+         t.frames, t.bad_frames, t.events.size(), begins, ends, done, t.lost);
+  const std::string thread = t.threads.count(0) ? t.threads.at(0) : "";
+  if (draws != flushes || begins != ends || open || mismatched || done != isr_done || t.bad_frames != 2 ||
+      thread != "main" || overflow != TRACE_EVENTS || t.lost != 100)
+  {
+    printf("  %ld drawArea begins for %d calls, %ld unmatched, %ld left open, %ld/%ld ISR events, thread \"%s\", "
+           "%ld events kept of a ring overflow\n",
+           draws, flushes, mismatched, open, done, (long)isr_done, thread.c_str(), overflow);
+    return false;
+  }
+  FILE *f = fopen("trace_check.json", "w");
+  if (f)
+  {
+    write_json(t, f);
+    fclose(f);
+    printf("Chrome trace written to trace_check.json\n");
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+    return convert(argv[1]);
+  if (!check())
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("Every event comes back from the frames\n");
+  return 0;
+}
@@ -0,0 +1,361 @@
+// Host benchmark: estimated frame time and bus utilisation of flush strategies (wire_model.h)
+//
+// Build and run from the sketch folder:
+//   gcc -c -std=gnu11 -I. -Itools/host low_level_amoled.c -o low_level_amoled.o &&
+//   g++ -std=gnu++17 -O2 -I. -Itools -Itools/host tools/wire_bench.cpp tools/host/emu_panel.cpp amoled.cpp
+//       low_level_amoled.o -o wire_bench && ./wire_bench [trace.txt] [queue_us=3] [gap_us=1.5] [poll_us=12] [stage_ns=2.5]
+//
+// A trace is a list of frames, each a list of the areas LVGL flushed. Without a file a built-in
+// trace of the surface level example is used. Uncomment PRINT_FLUSH_TRACE in the sketch to record
+// one on the board and copy the serial output to a file:
+//   area x1 y1 x2 y2   an area given to the flush callback (inclusive coordinates)
+//   frame              the end of a frame
+// Other lines are ignored.
+//
+// The driver as built runs against the panel emulator with two LVGL draw buffers of
+// LVGL_DMA_BUF_LINES rows (an area waits for the flush before the previous one to be done), and
+// the recorded transfers are replayed through the timing model. The other strategies are
+// generated from the same areas: the original scheme (a CASET/RASET/RAMWR window per 2 rows, one
+// strip buffer), windows of STRIP_SIZE bytes without round clipping, and one window per area sent
+// from the LVGL buffer. Bus speed, chunk size and queue depth are then swept on the driver trace.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "amoled.h"
+#include "amoled_round.h"
+#include "emu_panel.h"
+#include "wire_model.h"
+
+#define LVGL_DMA_BUF_LINES 40 // as in the sketch
+#define LVGL_BUF_PIXELS (DISPLAY_WIDTH * LVGL_DMA_BUF_LINES)
+
+struct Area
+{
+  int x1, y1, x2, y2;
+};
+typedef std::vector<Area> Frame;
+
+// The parts LVGL renders and flushes an area in, each one fits in the draw buffer
+static void lvgl_parts(Frame &f, int x1, int y1, int x2, int y2)
+{
+  x1 &= ~1; // rounder_event_cb
+  y1 &= ~1;
+  x2 |= 1;
+  y2 |= 1;
+  const int rows = LVGL_BUF_PIXELS / (x2 - x1 + 1);
+  for (int y = y1; y <= y2; y += rows)
+    f.push_back({x1, y, x2, (y + rows - 1 < y2) ? y + rows - 1 : y2});
+}
+
+// Surface level example: the first full screen, then the bubble moving with both angle labels
+static std::vector<Frame> builtin_trace()
+{
+  std::vector<Frame> frames;
+  Frame full;
+  lvgl_parts(full, 0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1);
+  frames.push_back(full);
+  const int cx = DISPLAY_WIDTH / 2, cy = DISPLAY_HEIGHT / 2;
+  for (int i = 0; i < 30; i++)
+  {
+    Frame f;
+    const int bx = 150 + 3 * i, by = 170 + 2 * i;
+    lvgl_parts(f, bx, by, bx + 52 + 3, by + 52 + 2); // old and new bubble, joined by LVGL
+    lvgl_parts(f, cx - 89, cy + 143, cx - 30, cy + 166);
+    lvgl_parts(f, cx + 39, cy + 143, cx + 98, cy + 166);
+    frames.push_back(f);
+  }
+  // A full-width band, like a scrolling list
+  for (int i = 0; i < 10; i++)
+  {
+    Frame f;
+    lvgl_parts(f, 0, 120, DISPLAY_WIDTH - 1, 339);
+    frames.push_back(f);
+  }
+  return frames;
+}
+
+static bool read_trace(const char *path, std::vector<Frame> &frames)
+{
+  FILE *in = fopen(path, "r");
+  if (!in)
+    return false;
+  char line[256];
+  Frame f;
+  while (fgets(line, sizeof(line), in))
+  {
+    Area a;
+    if (sscanf(line, " area %d %d %d %d", &a.x1, &a.y1, &a.x2, &a.y2) == 4 && a.x2 >= a.x1 && a.y2 >= a.y1)
+      f.push_back(a);
+    else if (strncmp(line, "frame", 5) == 0 && !f.empty())
+    {
+      frames.push_back(f);
+      f.clear();
+    }
+  }
+  if (!f.empty())
+    frames.push_back(f);
+  fclose(in);
+  return true;
+}
+
+// The driver against the emulator
+
+static std::vector<int> flush_done; // transaction that ended each flush of the frame
+static uint16_t *lvgl_buf[2];
+
+static void on_flush_done(void *)
+{
+  flush_done.push_back(emu_completing());
+}
+
+static bool in_lvgl_buf(const void *p)
+{
+  for (int b = 0; b < 2; b++)
+    if ((const uint16_t *)p >= lvgl_buf[b] && (const uint16_t *)p < lvgl_buf[b] + LVGL_BUF_PIXELS)
+      return true;
+  return false;
+}
+
+static std::vector<WireOp> driver_ops(Amoled &amoled, const Frame &frame)
+{
+  const size_t first = emu_transactions().size();
+  flush_done.clear();
+  for (size_t i = 0; i < frame.size(); i++)
+  {
+    // LVGL renders into the buffer of the flush before the previous one once that flush is done
+    if (i >= 2)
+    {
+      while (flush_done.size() < i - 1 && emu_complete_one())
+        ;
+      emu_depend(flush_done[i - 2]);
+    }
+    uint16_t *buf = lvgl_buf[i & 1];
+    const Area &a = frame[i];
+    const int n = (a.x2 - a.x1 + 1) * (a.y2 - a.y1 + 1);
+    for (int k = 0; k < n; k++)
+      buf[k] = (uint16_t)rand();
+    amoled.drawArea(a.x1, a.y1, a.x2, a.y2, buf);
+  }
+  emu_complete_all();
+
+  // Chunks back into transfers
+  const std::vector<EmuTransaction> &t = emu_transactions();
+  std::vector<WireOp> ops;
+  std::vector<int> op_of(t.size() - first);
+  for (size_t i = first; i < t.size(); i++)
+  {
+    if (t[i].first)
+    {
+      const int after = (t[i].after >= (int)first) ? op_of[t[i].after - first] : -1;
+      ops.push_back({t[i].color, t[i].color && !in_lvgl_buf(t[i].data), 0, after});
+    }
+    ops.back().bytes += t[i].bytes;
+    op_of[i - first] = (int)ops.size() - 1;
+  }
+  return ops;
+}
+
+// Generated strategies
+
+static void window(std::vector<WireOp> &ops, long pixel_bytes, bool staged, int after)
+{
+  ops.push_back({false, false, 4, after}); // CASET
+  ops.push_back({false, false, 4, -1});    // RASET
+  ops.push_back({true, staged, pixel_bytes, -1});
+}
+
+// Each area in windows of up to strip_bytes (or of `rows` rows), staged in a ring of `buffers`
+// strips and optionally clipped to the round panel. Without strip_bytes, one window per area.
+static std::vector<WireOp> strip_ops(const Frame &frame, int strip_bytes, int rows, int buffers, bool clip)
+{
+  std::vector<WireOp> ops;
+  std::vector<int> strips;     // op of each strip sent, for the ring
+  std::vector<int> flush_ends; // last op of each flush, for the LVGL buffers
+  for (size_t i = 0; i < frame.size(); i++)
+  {
+    const Area &a = frame[i];
+    const int w = even_width(a.x2 - a.x1 + 1), h = a.y2 - a.y1 + 1;
+    const int buf_after = (i >= 2) ? flush_ends[i - 2] : -1;
+    if (!strip_bytes)
+    {
+      // LVGL swaps the bytes in its buffer first (lv_draw_sw_rgb565_swap), which costs like staging
+      window(ops, (long)w * even_width(h) * 2, true, buf_after);
+      flush_ends.push_back((int)ops.size() - 1);
+      continue;
+    }
+    const int strip_h = rows ? rows : strip_rows(w, strip_bytes);
+    for (int row = 0; row < h; row += strip_h)
+    {
+      const int push_h = even_width((h - row < strip_h) ? h - row : strip_h);
+      int xa = a.x1, xb = a.x1 + w;
+      if (clip && !round_clip(a.y1 + row, push_h, xa, xb))
+        continue;
+      const int n = (int)strips.size();
+      int after = (n >= buffers) ? strips[n - buffers] : -1;
+      if (row == 0 && buf_after > after)
+        after = buf_after;
+      window(ops, (long)(xb - xa) * push_h * 2, true, after);
+      strips.push_back((int)ops.size() - 1);
+    }
+    flush_ends.push_back((int)ops.size() - 1);
+  }
+  return ops;
+}
+
+struct Totals
+{
+  double time_us = 0, worst_us = 0, busy_us = 0, wait_us = 0;
+  long transactions = 0, wire_bytes = 0;
+  int frames = 0;
+
+  void add(const WireResult &r)
+  {
+    time_us += r.time_us;
+    busy_us += r.busy_us;
+    wait_us += r.cpu_wait_us;
+    if (r.time_us > worst_us)
+      worst_us = r.time_us;
+    transactions += r.transactions;
+    wire_bytes += r.wire_bytes;
+    frames++;
+  }
+};
+
+static void print(const char *name, const Totals &t)
+{
+  printf("%-44s %8.2f %8.2f %6.1f%% %8.2f %8.0f %9.1f\n", name, t.time_us / t.frames / 1000, t.worst_us / 1000,
+         100.0 * t.busy_us / t.time_us, t.wait_us / t.frames / 1000, (double)t.transactions / t.frames,
+         t.wire_bytes / 1024.0 / t.frames);
+}
+
+static void header(const char *title)
+{
+  printf("\n%-44s %8s %8s %7s %8s %8s %9s\n", title, "avg ms", "worst ms", "bus", "wait ms", "trans", "KB/frame");
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<Frame> frames;
+  WireConfig base;
+  for (int i = 1; i < argc; i++)
+  {
+    double v;
+    if (sscanf(argv[i], "queue_us=%lf", &v) == 1)
+      base.queue_us = v;
+    else if (sscanf(argv[i], "gap_us=%lf", &v) == 1)
+      base.gap_us = v;
+    else if (sscanf(argv[i], "poll_us=%lf", &v) == 1)
+      base.poll_us = v;
+    else if (sscanf(argv[i], "stage_ns=%lf", &v) == 1)
+      base.stage_ns_per_byte = v;
+    else if (!read_trace(argv[i], frames))
+    {
+      printf("Cannot read %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (frames.empty())
+    frames = builtin_trace();
+  long areas = 0;
+  for (const Frame &f : frames)
+    areas += f.size();
+  printf("%zu frames, %ld flushes. Bus %.0f MHz, chunks of %d bytes, queue depth %d, strips of %d bytes\n",
+         frames.size(), areas, base.bus_hz / 1e6, base.transfer_size, base.queue_depth, STRIP_SIZE);
+  printf("Costs: queue %.1f us, gap %.1f us, polled command %.1f us, staging %.1f ns/byte\n", base.queue_us,
+         base.gap_us, base.poll_us, base.stage_ns_per_byte);
+
+  // Record the driver once, the transfers do not depend on the bus settings
+  emu_reset(CO5300_ID);
+  Amoled amoled;
+  if (!amoled.begin())
+  {
+    printf("begin() failed on the emulator\n");
+    return 1;
+  }
+  amoled.setFlushDoneCallback(on_flush_done, NULL);
+  for (int b = 0; b < 2; b++)
+    lvgl_buf[b] = (uint16_t *)heap_caps_malloc(LVGL_BUF_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+  emu_record(true);
+  std::vector<std::vector<WireOp>> driver;
+  for (const Frame &f : frames)
+    driver.push_back(driver_ops(amoled, f));
+
+  struct
+  {
+    const char *name;
+    int strip_bytes, rows, buffers;
+    bool clip;
+  } strategies[] = {
+      {"2-row windows, one strip buffer", 4 * DISPLAY_WIDTH, 2, 1, false},
+      {"STRIP_SIZE windows, no round clipping", STRIP_SIZE, 0, STRIP_BUFFERS, false},
+      {"STRIP_SIZE windows, round clipped", STRIP_SIZE, 0, STRIP_BUFFERS, true},
+      {"one window per area from the LVGL buffer", 0, 0, 0, false},
+  };
+  header("strategy");
+  {
+    WireModel model(base);
+    Totals t;
+    for (const auto &ops : driver)
+      t.add(model.replay(ops));
+    print("driver as built", t);
+  }
+  for (const auto &s : strategies)
+  {
+    WireModel model(base);
+    Totals t;
+    for (const Frame &f : frames)
+      t.add(model.replay(strip_ops(f, s.strip_bytes, s.rows, s.buffers, s.clip)));
+    print(s.name, t);
+  }
+
+  header("driver as built, bus speed");
+  for (double mhz : {40.0, 60.0, 80.0})
+  {
+    WireConfig cfg = base;
+    cfg.bus_hz = mhz * 1e6;
+    WireModel model(cfg);
+    Totals t;
+    for (const auto &ops : driver)
+      t.add(model.replay(ops));
+    char name[64];
+    snprintf(name, sizeof(name), "%.0f MHz", mhz);
+    print(name, t);
+  }
+
+  header("driver as built, queue depth");
+  for (int depth : {1, 2, 4, 8, 32})
+  {
+    WireConfig cfg = base;
+    cfg.queue_depth = depth;
+    WireModel model(cfg);
+    Totals t;
+    for (const auto &ops : driver)
+      t.add(model.replay(ops));
+    char name[64];
+    snprintf(name, sizeof(name), "%d", depth);
+    print(name, t);
+  }
+
+  // Bigger chunks only change the transfers larger than TRANSFER_SIZE: strips are sized for a
+  // chunk, so the strip size moves with it in the generated strategy below
+  header("TRANSFER_SIZE (= strip size), driver / windows");
+  for (int size : {1020, 2044, 4092, 8188, 16380, 32764})
+  {
+    WireConfig cfg = base;
+    cfg.transfer_size = size;
+    WireModel a(cfg), b(cfg);
+    Totals ta, tb;
+    for (const auto &ops : driver)
+      ta.add(a.replay(ops));
+    for (const Frame &f : frames)
+      tb.add(b.replay(strip_ops(f, size, 0, STRIP_BUFFERS, true)));
+    char name[64];
+    snprintf(name, sizeof(name), "%d bytes, driver (strips stay %d)", size, STRIP_SIZE);
+    print(name, ta);
+    snprintf(name, sizeof(name), "%d bytes, round-clipped windows", size);
+    print(name, tb);
+  }
+  return 0;
+}
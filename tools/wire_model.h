@@ -0,0 +1,138 @@
+// Timing model of the QSPI link to the panel, for the host tools
+//
+// Panel transfers (a tx_param with its parameters, or a tx_color with its pixels) are replayed in
+// order the way the SPI driver puts them on the bus:
+//  - every transaction has a 32-bit command phase on one line, parameters follow on one line and
+//    pixels on four (2 clocks per byte)
+//  - a tx_color is split in chunks of transfer_size bytes, each one is a queued transaction that
+//    costs the CPU queue_us to submit and leaves the bus idle gap_us after the previous one
+//  - at most queue_depth chunks are in flight, the CPU waits for the oldest one to submit another
+//  - a tx_param waits until every chunk in flight is done, then is sent polling (poll_us more)
+//  - a transfer can wait for the end of an earlier one (a strip or an LVGL buffer coming back)
+//  - the CPU stages stage_ns_per_byte for every pixel byte before queuing it
+// The time the application spends rendering is not part of the model: the frame time is the
+// time the display driver keeps the CPU and the bus busy.
+//
+// The default costs are estimates for an ESP32-S3 at 240 MHz, pass others to compare.
+//
+#ifndef WIRE_MODEL_H
+#define WIRE_MODEL_H
+
+#include <deque>
+#include <vector>
+#include "board_config.h"
+
+struct WireConfig
+{
+  double bus_hz = BUS_SPEED;
+  int transfer_size = TRANSFER_SIZE;
+  int queue_depth = TRANSFER_QUEUE_DEPTH;
+  double queue_us = 3.0;           // CPU time to queue one transaction (spi_device_queue_trans)
+  double gap_us = 1.5;             // bus idle time between two queued transactions (interrupt, DMA setup)
+  double poll_us = 12.0;           // extra time of a polled transaction (bus acquire, setup, busy wait)
+  double stage_ns_per_byte = 2.5;  // CPU time to stage (copy and byte swap) one pixel byte
+};
+
+// One panel transfer
+struct WireOp
+{
+  bool color;      // tx_color, otherwise tx_param
+  bool staged;     // the CPU copies the pixels before queuing them
+  long bytes;      // parameter or pixel bytes
+  int after;       // index of an earlier op that must be done before this one is issued, -1 for none
+};
+
+struct WireResult
+{
+  double time_us = 0;   // from the first op issued to the last one done
+  double busy_us = 0;   // time the bus is clocking bits
+  double cpu_wait_us = 0; // time the CPU waits for the bus (queue full, tx_param, dependencies)
+  long transactions = 0;
+  long wire_bytes = 0;  // command phases, parameters and pixels
+
+  double utilisation() const { return time_us > 0 ? busy_us / time_us : 0; }
+};
+
+class WireModel
+{
+public:
+  explicit WireModel(const WireConfig &config) : cfg(config) {}
+
+  // Replay the ops, continuing from where the previous call stopped
+  WireResult replay(const std::vector<WireOp> &ops)
+  {
+    WireResult res;
+    const double t0 = (cpu > bus_free) ? cpu : bus_free;
+    cpu = t0;
+    std::vector<double> done(ops.size(), 0);
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+      const WireOp &op = ops[i];
+      if (op.after >= 0 && op.after < (int)i)
+        wait(done[op.after], res);
+      if (!op.color)
+      {
+        // tx_param: the queue is drained first, then the command goes out polling
+        if (!inflight.empty())
+          wait(inflight.back(), res);
+        inflight.clear();
+        const double start = (cpu > bus_free) ? cpu : bus_free;
+        const double wire = clocks(32 + 8 * op.bytes);
+        res.busy_us += wire;
+        res.transactions++;
+        res.wire_bytes += 4 + op.bytes;
+        bus_free = cpu = done[i] = start + cfg.poll_us + wire;
+        continue;
+      }
+      if (op.staged)
+        cpu += op.bytes * cfg.stage_ns_per_byte / 1000.0;
+      for (long sent = 0; sent < op.bytes || sent == 0;)
+      {
+        const long len = (op.bytes - sent < cfg.transfer_size) ? op.bytes - sent : cfg.transfer_size;
+        while (!inflight.empty() && inflight.front() <= cpu)
+          inflight.pop_front();
+        if ((int)inflight.size() >= cfg.queue_depth)
+        {
+          wait(inflight.front(), res);
+          inflight.pop_front();
+        }
+        cpu += cfg.queue_us;
+        const double ready = bus_free + cfg.gap_us;
+        const double start = (cpu > ready) ? cpu : ready;
+        const double wire = clocks((sent == 0 ? 32 : 0) + 2 * len);
+        res.busy_us += wire;
+        res.transactions++;
+        res.wire_bytes += (sent == 0 ? 4 : 0) + len;
+        bus_free = done[i] = start + wire;
+        inflight.push_back(bus_free);
+        sent += len;
+        if (len == 0)
+          break;
+      }
+    }
+    const double end = (cpu > bus_free) ? cpu : bus_free;
+    res.time_us = end - t0;
+    cpu = end;
+    inflight.clear();
+    return res;
+  }
+
+private:
+  WireConfig cfg;
+  double cpu = 0;      // when the CPU issues the next op
+  double bus_free = 0; // when the last transaction queued leaves the bus
+  std::deque<double> inflight; // end times of the chunks in flight
+
+  double clocks(long n) const { return n * 1e6 / cfg.bus_hz; }
+
+  void wait(double t, WireResult &res)
+  {
+    if (t > cpu)
+    {
+      res.cpu_wait_us += t - cpu;
+      cpu = t;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,173 @@
+// Event trace in a lock-free ring (see trace.h)
+//
+#include "trace.h"
+
+#if TRACE_EVENTS
+#include <stdbool.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#if TRACE_EVENTS & (TRACE_EVENTS - 1)
+#error "TRACE_EVENTS must be a power of two"
+#endif
+
+#define TRACE_EVENT_BYTES 10  // type, thread, name, timestamp
+#define TRACE_FRAME_NAMES 64  // names sent in one frame, the others are sent again with each event
+
+typedef struct
+{
+    uint32_t seq; // index of the event + 1 once it is written, 0 while it is being written
+    uint32_t ts_us;
+    const char *name;
+    uint8_t type;
+    uint8_t thread;
+} trace_slot_t;
+
+static trace_slot_t ring[TRACE_EVENTS];
+static uint32_t head; // events claimed, from any core
+static uint32_t tail; // events drained, by trace_drain only
+static uint32_t lost_events; // overwritten events not reported yet
+static TaskHandle_t tasks[TRACE_TASKS]; // thread number of a task: its index, claimed at its first event
+static char task_names[TRACE_TASKS][configMAX_TASK_NAME_LEN];
+static uint32_t tasks_named; // tasks whose name is copied
+
+static uint8_t IRAM_ATTR trace_thread(void)
+{
+    if (xPortInIsrContext())
+        return TRACE_ISR;
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (uint8_t i = 0; i < TRACE_TASKS; i++)
+    {
+        TaskHandle_t t = __atomic_load_n(&tasks[i], __ATOMIC_ACQUIRE);
+        if (t == task)
+            return i;
+        if (t)
+            continue;
+        // First event of the task: the name is copied now, the task may be deleted before the drain
+        if (__atomic_compare_exchange_n(&tasks[i], &t, task, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            strncpy(task_names[i], pcTaskGetName(NULL), configMAX_TASK_NAME_LEN - 1);
+            __atomic_or_fetch(&tasks_named, 1UL << i, __ATOMIC_RELEASE);
+            return i;
+        }
+        if (t == task)
+            return i;
+    }
+    return TRACE_OTHER_TASK;
+}
+
+void IRAM_ATTR trace_event(char type, const char *name)
+{
+    const uint8_t thread = trace_thread() | (xPortGetCoreID() ? 0x80 : 0);
+    const uint32_t i = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    trace_slot_t *s = &ring[i & (TRACE_EVENTS - 1)];
+    __atomic_store_n(&s->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->ts_us = (uint32_t)esp_timer_get_time();
+    s->name = name;
+    s->type = (uint8_t)type;
+    s->thread = thread;
+    __atomic_store_n(&s->seq, i + 1, __ATOMIC_RELEASE);
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+size_t trace_drain(uint8_t *buf, size_t size)
+{
+    if (size < TRACE_FRAME_HEADER + 5 + TRACE_EVENT_BYTES)
+        return 0;
+    uint8_t *p = buf + TRACE_FRAME_HEADER;
+    uint8_t *const end = buf + (size > TRACE_FRAME_HEADER + 0xFFFF ? TRACE_FRAME_HEADER + 0xFFFF : size);
+    const uint32_t claimed = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    uint32_t lost = lost_events;
+    if (claimed - tail > TRACE_EVENTS)
+    {
+        lost += claimed - TRACE_EVENTS - tail;
+        tail = claimed - TRACE_EVENTS;
+    }
+    const char *names[TRACE_FRAME_NAMES];
+    uint8_t name_count = 0;
+    uint64_t threads_sent = 0;
+    const uint32_t named = __atomic_load_n(&tasks_named, __ATOMIC_ACQUIRE);
+    for (; tail != claimed; tail++)
+    {
+        const trace_slot_t *s = &ring[tail & (TRACE_EVENTS - 1)];
+        const uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        const trace_slot_t e = *s;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != tail + 1 || __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq)
+        {
+            // Still being written: the next drain takes it. Overwritten since: lost
+            if (seq == 0 || seq < tail + 1)
+                break;
+            lost++;
+            continue;
+        }
+        // The name and the task of the event, the first time they appear in the frame
+        uint8_t i = 0;
+        while (i < name_count && names[i] != e.name)
+            i++;
+        const size_t name_len = (i < name_count) ? 0 : strnlen(e.name, 255);
+        const uint8_t task = e.thread & 0x7F;
+        const bool send_thread = task < TRACE_TASKS && (named & (1UL << task)) && !(threads_sent & (1ULL << task));
+        const size_t thread_len = send_thread ? strnlen(task_names[task], configMAX_TASK_NAME_LEN) : 0;
+        const size_t need = TRACE_EVENT_BYTES + (i < name_count ? 0 : 6 + name_len) + (send_thread ? 3 + thread_len : 0) +
+                            (lost ? 5 : 0);
+        if ((size_t)(end - p) < need)
+            break;
+        if (lost)
+        {
+            *p++ = TRACE_RECORD_LOST;
+            p = put32(p, lost);
+            lost = 0;
+        }
+        if (i == name_count)
+        {
+            *p++ = TRACE_RECORD_NAME;
+            p = put32(p, (uint32_t)(uintptr_t)e.name);
+            *p++ = name_len;
+            memcpy(p, e.name, name_len);
+            p += name_len;
+            if (name_count < TRACE_FRAME_NAMES)
+                names[name_count++] = e.name;
+        }
+        if (send_thread)
+        {
+            *p++ = TRACE_RECORD_THREAD;
+            *p++ = task;
+            *p++ = thread_len;
+            memcpy(p, task_names[task], thread_len);
+            p += thread_len;
+            threads_sent |= 1ULL << task;
+        }
+        *p++ = e.type;
+        *p++ = e.thread;
+        p = put32(p, (uint32_t)(uintptr_t)e.name);
+        p = put32(p, e.ts_us);
+    }
+    if (lost && end - p >= 5)
+    {
+        *p++ = TRACE_RECORD_LOST;
+        p = put32(p, lost);
+        lost = 0;
+    }
+    lost_events = lost;
+    const size_t payload = p - buf - TRACE_FRAME_HEADER;
+    if (!payload)
+        return 0;
+    memcpy(buf, TRACE_FRAME_MAGIC, 4);
+    buf[4] = payload;
+    buf[5] = payload >> 8;
+    return p - buf;
+}
+#endif
@@ -0,0 +1,65 @@
+// Event trace: timestamped begin/end events in a lock-free ring, from tasks and ISRs on both cores
+//
+// TRACE_EVENTS in board_config.h sets the size of the ring, 0 compiles the trace out. trace_drain()
+// packs the events into frames written to the serial port as they are, interleaved with the text:
+// tools/trace_json.cpp picks the frames out of a capture and writes a Chrome trace (chrome://tracing,
+// ui.perfetto.dev).
+//
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board_config.h"
+
+// Frame: TRACE_FRAME_MAGIC, payload size (uint16_t), then records, all little-endian
+#define TRACE_FRAME_MAGIC "\xA5TRC"
+#define TRACE_FRAME_HEADER 6
+// Records of a frame, each one starts with its type
+#define TRACE_RECORD_BEGIN 'B'  // uint8_t thread, uint32_t name, uint32_t timestamp (us)
+#define TRACE_RECORD_END 'E'    // same fields
+#define TRACE_RECORD_INSTANT 'i' // same fields
+#define TRACE_RECORD_NAME 'N'   // uint32_t name, uint8_t length, the characters
+#define TRACE_RECORD_THREAD 'T' // uint8_t thread, uint8_t length, the characters of the task name
+#define TRACE_RECORD_LOST 'L'   // uint32_t events overwritten before they were drained
+// Thread of an event: bit 7 is the core, the other bits the task (TRACE_ISR when it comes from an ISR)
+#define TRACE_ISR 0x7F
+#define TRACE_TASKS 32          // Tasks with a name in the trace, the others share TRACE_OTHER_TASK
+#define TRACE_OTHER_TASK (TRACE_TASKS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if TRACE_EVENTS
+// `name` must outlive the trace (a literal or __func__): the events keep the pointer
+void trace_event(char type, const char *name);
+// Packs the events since the last call into one frame of at most `size` bytes, returns its size (0: no event)
+size_t trace_drain(uint8_t *buf, size_t size);
+#define TRACE_BEGIN(name) trace_event(TRACE_RECORD_BEGIN, name)
+#define TRACE_END(name) trace_event(TRACE_RECORD_END, name)
+#define TRACE_INSTANT(name) trace_event(TRACE_RECORD_INSTANT, name)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+
+// Begin now, end when the scope is left
+struct TraceScope
+{
+    const char *name;
+    explicit TraceScope(const char *n) : name(n) { TRACE_BEGIN(n); }
+    ~TraceScope() { TRACE_END(name); }
+};
+#if TRACE_EVENTS
+#define TRACE_SCOPE(name) TraceScope trace_scope_(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+#endif
+
+#endif
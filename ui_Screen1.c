@@ -5,6 +5,9 @@
 
 #include "ui.h"
 
+// Baked by tools/asset_bake.cpp: ui_Image3 shows ui_img_surface_level_baked
+LV_IMAGE_DECLARE(ui_img_surface_level_baked);
+
 lv_obj_t * uic_target_on;
 lv_obj_t * uic_target_off;
 lv_obj_t * uic_Label_y;
@@ -42,15 +45,14 @@ void ui_Screen1_screen_init(void)
     lv_obj_remove_flag(ui_Screen1, LV_OBJ_FLAG_SCROLLABLE);      /// Flags
 
     ui_Image3 = lv_image_create(ui_Screen1);
-    lv_image_set_src(ui_Image3, &ui_img_surface_level_png);
+    lv_image_set_src(ui_Image3, &ui_img_surface_level_baked);
     lv_obj_set_width(ui_Image3, LV_SIZE_CONTENT);   /// 1
     lv_obj_set_height(ui_Image3, LV_SIZE_CONTENT);    /// 1
-    lv_obj_set_x(ui_Image3, 3);
-    lv_obj_set_y(ui_Image3, 15);
-    lv_obj_set_align(ui_Image3, LV_ALIGN_CENTER);
+    lv_obj_set_x(ui_Image3, 0);
+    lv_obj_set_y(ui_Image3, 0);
+    lv_obj_set_align(ui_Image3, LV_ALIGN_TOP_LEFT);
     lv_obj_add_flag(ui_Image3, LV_OBJ_FLAG_CLICKABLE);     /// Flags
     lv_obj_remove_flag(ui_Image3, LV_OBJ_FLAG_SCROLLABLE);      /// Flags
-    lv_image_set_scale(ui_Image3, 350);
 
     ui_Image2 = lv_image_create(ui_Screen1);
     lv_image_set_src(ui_Image2, &ui_img_bubble_png);
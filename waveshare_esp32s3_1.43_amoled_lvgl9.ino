@@ -10,20 +10,134 @@
 #define USE_BUILT_IN_SURFACE_LEVEL_EXAMPLE
 
 #include <lvgl.h> // Install "lvgl" with the Library Manager (last tested on v9.2.2)
+#include <src/display/lv_display_private.h> // Render mode and flushing state of the display
 #include "amoled.h"
+#include "amoled_coalesce.h"
+#include "board_init.h"
+#include "draw_buffers.h"
+#include "fill_unit.h"
+#include "trace.h"
 #include "FT3168.h"   // Capacitive Touch functions
 #include "qmi8658c.h" // QMI8658 6-axis IMU (3-axis accelerometer and 3-axis gyroscope) functions
 #include "ui.h"
 
 Amoled amoled; // Main object for the display board
-
-// LVGL Display buffer size
-#define LVGL_DRAW_BUF_SIZE (DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(lv_color_t))
+BoardInit board; // Bring-up steps of the board, run in parallel (board_init.h)
+
+// LVGL draw buffers (draw_buffers.h): DRAW_BUF_STRATEGY is the index of the strategy to use in
+// draw_buf_strategies below. The default is bands of 40 rows in internal DMA-capable RAM: fast to render
+// into, and the display driver sends them without copying them. Uncomment TUNE_DRAW_BUFFERS to time each
+// strategy that fits in the RAM budgets at boot (a few seconds), print the results and keep the fastest.
+// Neither the other strategies nor the tuner have been timed on the board yet: both stay opt-in, and the
+// default is the buffers the sketch used before
+#define DRAW_BUF_STRATEGY 0
+// #define TUNE_DRAW_BUFFERS
+#define DRAW_BUF_TUNE_FRAMES 5
+#define DRAW_BUF_SRAM_BUDGET (96 * 1024)
+#define DRAW_BUF_PSRAM_BUDGET (2 * 1024 * 1024)
+
+// Areas invalidated in the same frame are merged when one panel window costs less to send than
+// several (amoled_coalesce.h). Comment the next line to flush every area LVGL invalidates on its own
+#define COALESCE_DIRTY_AREAS
+
+// Opaque solid fills covering a whole band (a plain background) are not rendered: the band is sent
+// from a DMA strip of its color (fill_unit.h). Comment the next line to render every fill
+#define SOLID_FILL_UNIT
+
+// Uncomment the next line to print the display flush statistics on the serial monitor every 5 seconds
+// #define SHOW_FLUSH_STATS
+
+// Uncomment the next line to print every flushed area on the serial monitor, a trace for tools/wire_bench.cpp
+// #define PRINT_FLUSH_TRACE
+
+// With FLUSH_PROFILE set to 1 in board_config.h, uncomment the next lines to show the profile of the
+// last frame on the screen (twice a second, the label adds a small flush of its own) and/or to
+// print one CSV line per frame on the serial monitor
+// #define SHOW_FLUSH_HUD
+// #define PRINT_FLUSH_CSV
+
+// Uncomment the next lines to save power when the board sits on a bench: idle mode (8 colors) after
+// POWER_IDLE_AFTER_MS without a touch, sleep after POWER_SLEEP_AFTER_MS (LVGL stops rendering), and
+// back to normal on the next touch
+// #define POWER_IDLE_AFTER_MS 30000
+// #define POWER_SLEEP_AFTER_MS 300000
+
+// With TRACE_EVENTS set in board_config.h, the event trace is sent on the serial port every
+// TRACE_STREAM_MS in binary frames, mixed with the text: capture the port to a file and convert it
+// with tools/trace_json.cpp. Set LV_USE_PROFILER to 1 in lv_conf.h to trace LVGL's own phases too
+#define TRACE_STREAM_MS 50
+
+// LVGL runs in loop() with a fixed delay(5). Set LVGL_TASK to 1 to run it in a task of its own
+// (LVGL_TASK_CORE, LVGL_TASK_PRIORITY) that sleeps until the next LVGL timer is due, or until a touch
+// (PIN_NUM_TOUCH_INT in board_config.h), a new IMU sample or the end of a frame on the bus wakes it.
+// Off until it is measured on the board: compare both with SHOW_LVGL_TASK_STATS
+#define LVGL_TASK 0
+#define LVGL_TASK_CORE 1
+#define LVGL_TASK_PRIORITY 1 // the one of the loop task
+#define LVGL_TASK_STACK 8192
+
+// Uncomment the next line to print how often LVGL woke up and how late its timers ran, every 5 seconds
+// #define SHOW_LVGL_TASK_STATS
+
+// Uncomment the next line to time the rendering of Screen1 (background, bubble, labels) once the
+// board is up: RENDER_BENCH_FRAMES full-screen frames and bubble moves, rendered alone (the flush to the
+// panel replaced by a no-op), then sent to the panel. Build it with ui_Screen1.c as exported and as
+// baked (tools/asset_bake.cpp) to see what baking saves
+// #define RENDER_BENCH
+#define RENDER_BENCH_FRAMES 20
+
+// setup() waits up to SERIAL_WAIT_MS for a serial monitor on the USB port, alongside the other bring-up
+// steps: the boot timeline is printed once it is there. Set it to 0 to never wait
+#define SERIAL_WAIT_MS 4000
+
+// Draw buffer strategies: PSRAM fits full-screen buffers (434 KB each), which DIRECT mode needs to only
+// render what changed and FULL mode to render the whole screen in one go
+const DrawBufferStrategy draw_buf_strategies[] = {
+    {"SRAM 2 x 40 rows", LV_DISPLAY_RENDER_MODE_PARTIAL, DRAW_BUF_SRAM, 40, 2},
+    {"SRAM 2 x 20 rows", LV_DISPLAY_RENDER_MODE_PARTIAL, DRAW_BUF_SRAM, 20, 2},
+    {"SRAM 1 x 80 rows", LV_DISPLAY_RENDER_MODE_PARTIAL, DRAW_BUF_SRAM, 80, 1},
+    {"PSRAM 2 x full, partial", LV_DISPLAY_RENDER_MODE_PARTIAL, DRAW_BUF_PSRAM, DISPLAY_HEIGHT, 2},
+    {"PSRAM 2 x full, direct", LV_DISPLAY_RENDER_MODE_DIRECT, DRAW_BUF_PSRAM, DISPLAY_HEIGHT, 2},
+    {"PSRAM 2 x full, full", LV_DISPLAY_RENDER_MODE_FULL, DRAW_BUF_PSRAM, DISPLAY_HEIGHT, 2},
+};
+#define DRAW_BUF_STRATEGIES (sizeof(draw_buf_strategies) / sizeof(draw_buf_strategies[0]))
 
 // LVGL global variables for the display and its buffers
 lv_display_t *disp;
-lv_color_t *lvgl_buf1 = nullptr;
-lv_color_t *lvgl_buf2 = nullptr;
+DrawBuffers draw_buffers;
+FillUnit fill_unit; // bands of one color, sent without being rendered
+SemaphoreHandle_t flush_done_sem = nullptr; // given on each flush done, LVGL waits on it instead of spinning
+lv_indev_t *indev = nullptr;                // the touchpad
+
+// Notification bits of the LVGL task: what woke it up
+#define LVGL_WAKE_INPUT 0x01 // touch interrupt
+#define LVGL_WAKE_IMU 0x02   // a new IMU sample for the bubble
+#define LVGL_WAKE_FLUSH 0x04 // the last area of a frame has left the bus
+TaskHandle_t lvgl_task_handle = nullptr;
+lv_timer_t *bubble_timer = nullptr;
+
+// Wakeups of the LVGL service and lateness of its timers, since the last print (SHOW_LVGL_TASK_STATS)
+struct LvglServiceStats
+{
+    uint32_t wakeups;
+    uint32_t input, imu, flush; // wakeups by a notification
+    uint32_t late_count;        // wakeups after a timer was due
+    uint64_t late_sum_us;
+    uint32_t late_max_us;
+};
+LvglServiceStats lvgl_stats;
+#if FLUSH_PROFILE && defined(SHOW_FLUSH_HUD)
+lv_obj_t *flush_hud = nullptr; // label showing the flush profile
+#endif
+#if defined(POWER_IDLE_AFTER_MS) || defined(POWER_SLEEP_AFTER_MS)
+#define USE_POWER_POLICY
+#endif
+bool panel_asleep = false; // the panel is in sleep mode, LVGL does not render
+uint32_t touch_step = 0; // board step of the touch controller, LVGL reads no touch before it is done
+uint32_t boot_steps = 0; // every board step, the boot timeline is printed once they are all done
+#if TE_SYNC
+bool te_paced = false; // LVGL renders once per panel refresh, on the tearing effect pulses (TE_SYNC in board_config.h)
+#endif
 
 #ifdef USE_BUILT_IN_SURFACE_LEVEL_EXAMPLE
 // Globals for the surface level example
@@ -50,95 +164,383 @@ extern lv_obj_t *uic_Label_y;    // Label for the x position of the bubble
 void setup()
 {
     Serial.begin(115200);
-
-    // Optional: Give time to the serial port to show initial messages printed on the serial monitor upon reset
-    delay(4000);
-
-    // Initialize the touch screen
-    Serial.println("Touche screen initialization");
-    Touch_Init();
-
-    // Initialize QMI8658 6-axis IMU
-    Serial.println("QMI8658 6-axis IMU initialization");
-    qmi8658_init();
-    delay(1000); // Do not change this delay, it is required by the QMI8658
-
-    // Display initialization
-    Serial.println("Amoled display initialization");
-    if (!amoled.begin())
-    {
-        Serial.println("Display initialization failed!");
-        while (true)
-        {
-            /* no need to continue */
-        }
-    }
-    Serial.printf("Display controller name is %s (id=%d)\n", amoled.name(), amoled.ID());
-
-    // LVGL initialization
+    TRACE_BEGIN("setup");
+
+    // Independent bring-up steps run in parallel tasks: the display and the LVGL buffers do not wait
+    // for the IMU calibration. The I2C bus is installed by the touch step, the IMU shares it.
+    // Steps that install interrupts are pinned to the core of setup(), where they were before
+    const BaseType_t core = xPortGetCoreID();
+    const uint32_t serial_step = board.add("serial", wait_serial);
+    touch_step = board.add("touch", init_touch, NULL, 0, core);
+    const uint32_t imu_step = board.add("imu", init_imu, NULL, touch_step, 0);
+    const uint32_t panel_step = board.add("panel", init_panel, NULL, 0, core);
+    const uint32_t buffers_step = board.add("lvgl buffers", alloc_lvgl_buffers);
+    boot_steps = serial_step | touch_step | imu_step | panel_step | buffers_step;
+    board.start();
+
+    // LVGL initialization, meanwhile
     Serial.println("LVGL initialization");
+    TRACE_BEGIN("lv_init");
     lv_init();
     lv_tick_set_cb(millis_cb);
+    TRACE_END("lv_init");
 
-    // LVGL Buffers allocation for the display
-    Serial.println("LVGL buffers allocation");
-    lvgl_buf1 = (lv_color_t *)heap_caps_malloc(LVGL_DRAW_BUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!lvgl_buf1)
-    {
-        Serial.println("LVGL buffer 1 allocate failed!");
-        while (true)
-        {
-        }
-    }
-    lvgl_buf2 = (lv_color_t *)heap_caps_malloc(LVGL_DRAW_BUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!lvgl_buf2)
+    // The display needs the panel and the buffers, not the IMU
+    TRACE_BEGIN("wait display");
+    const bool display_ready = board.wait(panel_step | buffers_step);
+    TRACE_END("wait display");
+    if (!display_ready)
     {
-        Serial.println("LVGL buffer 2 allocate failed!");
+        Serial.println(board.failed(panel_step) ? "Display initialization failed!" : "LVGL buffers allocation failed!");
+        board.printTimeline(print_line);
         while (true)
         {
+            /* no need to continue */
         }
     }
+    Serial.printf("Display controller name is %s (id=%d)\n", amoled.name(), amoled.ID());
+    // The panel memory holds garbage until LVGL draws the first frame: start dark and fade in
+    amoled.setBrightness(0);
+    amoled.fadeBrightness(0xFF, 500);
 
     // Create the LVGL display
+    TRACE_BEGIN("lvgl setup");
     disp = lv_display_create(DISPLAY_WIDTH, DISPLAY_HEIGHT);
     lv_display_set_flush_cb(disp, my_disp_flush);
-    lv_display_set_buffers(disp, lvgl_buf1, lvgl_buf2, LVGL_DRAW_BUF_SIZE, LV_DISPLAY_RENDER_MODE_PARTIAL);
+    flush_done_sem = xSemaphoreCreateBinary();
+    lv_display_set_flush_wait_cb(disp, my_disp_flush_wait);
+    amoled.setFlushDoneCallback(my_disp_flush_done, disp);
+    draw_buffers.apply(disp);
+#ifdef SOLID_FILL_UNIT
+    if (!fill_unit.begin(disp))
+        Serial.println("Fill draw unit creation failed, every fill is rendered");
+#endif
     lv_display_add_event_cb(disp, rounder_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+#ifdef COALESCE_DIRTY_AREAS
+    lv_display_add_event_cb(disp, coalesce_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    lv_display_add_event_cb(disp, coalesce_event_cb, LV_EVENT_RENDER_START, NULL);
+#endif
 
     // Create the LVGL input touchpad device
-    lv_indev_t *indev = lv_indev_create();
+    indev = lv_indev_create();
     lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
     lv_indev_set_read_cb(indev, lvgl_touchpad_read);
 
+    // Brightness fades are stepped by an LVGL timer, between flushes
+    lv_timer_create(update_brightness, BRIGHTNESS_STEP_MS, NULL);
+#ifdef SHOW_LVGL_TASK_STATS
+    lv_timer_create(print_lvgl_stats, 5000, NULL);
+#endif
+#ifdef SHOW_FLUSH_STATS
+    lv_timer_create(print_flush_stats, 5000, NULL);
+#endif
+#ifdef USE_POWER_POLICY
+    amoled.setPowerPolicy(power_policy, NULL);
+    lv_timer_create(update_power, 250, NULL);
+#endif
+#if TE_SYNC
+    // With the TE line, the refresh timer of the display is paused and LVGL renders right after each pulse
+    te_paced = amoled.waitTearingEffect(100);
+    if (te_paced)
+        lv_timer_pause(lv_display_get_refr_timer(disp));
+    else
+        Serial.println("No tearing effect pulse, LVGL keeps its own refresh period");
+#endif
+#if FLUSH_PROFILE && defined(PRINT_FLUSH_CSV)
+    Serial.println("frame,flushes,transfers,windows,bytes_sent,pad_bytes,filler_bytes,stage_us,wait_us,call_us,latency_avg_us,latency_max_us,frame_us,period_us");
+#endif
+
     // Register LVGL print function for logging
 #if LV_USE_LOG != 0
     lv_log_register_print_cb(my_print);
 #endif
 
+    TRACE_END("lvgl setup");
+
+    TRACE_BEGIN("ui_init");
 #ifdef USE_BUILT_IN_SURFACE_LEVEL_EXAMPLE
-    // Launch the UI example
+    // Launch the UI example, the IMU task is started by the imu step once the QMI8658 is calibrated
     ui_init();
-    // Create the task to read QMI8658 6-axis IMU (3-axis accelerometer and 3-axis gyroscope)
-    xTaskCreatePinnedToCore(imu_task, "imu", 4096, NULL, 2, NULL, 0);
-    // Periodic timer to update/move the bubble image using latest IMU data
-    lv_timer_create(move_bubble, MOVE_BUBBLE_INTERVAL_MS, NULL); // ~20 Hz
+    // Periodic timer to update/move the bubble image using latest IMU data, run early by the IMU task
+    // right after a sample with LVGL_TASK
+    bubble_timer = lv_timer_create(move_bubble, MOVE_BUBBLE_INTERVAL_MS, NULL); // ~20 Hz
 #else
     // If you want to use a UI created with Squarline Studio, call it here
     ui_init();
 #endif
+    TRACE_END("ui_init");
+
+#if FLUSH_PROFILE && defined(SHOW_FLUSH_HUD)
+    // On the top layer, above the UI, low enough to be inside the round panel
+    flush_hud = lv_label_create(lv_layer_top());
+    lv_obj_set_style_text_align(flush_hud, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_style_text_color(flush_hud, lv_color_white(), 0);
+    lv_obj_set_style_bg_color(flush_hud, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(flush_hud, LV_OPA_60, 0);
+    lv_obj_align(flush_hud, LV_ALIGN_TOP_MID, 0, 40);
+    lv_label_set_text(flush_hud, "");
+    lv_timer_create(show_flush_hud, 500, NULL);
+#endif
+
+#ifdef TUNE_DRAW_BUFFERS
+    // Renders Screen1 many times over, the panel is still dark
+    TRACE_BEGIN("tune draw buffers");
+    DrawBufferResult results[DRAW_BUF_STRATEGIES];
+    const int best = draw_buffers.tune(disp, draw_buf_strategies, DRAW_BUF_STRATEGIES, DRAW_BUF_SRAM_BUDGET,
+                                       DRAW_BUF_PSRAM_BUDGET, results, DRAW_BUF_TUNE_FRAMES, bench_change);
+    DrawBuffers::printResults(draw_buf_strategies, results, DRAW_BUF_STRATEGIES, best, print_line);
+    TRACE_END("tune draw buffers");
+#endif
+
+    // First frame now, rather than at the first refresh period, then the timeline once every step is done
+    TRACE_BEGIN("first frame");
+    lv_refr_now(disp);
+    TRACE_END("first frame");
+    board.mark("first frame");
+    lv_timer_create(print_boot_timeline, 100, NULL);
+#ifdef RENDER_BENCH
+    lv_timer_create(render_bench, 100, NULL);
+#endif
+#if TRACE_EVENTS
+    lv_timer_create(stream_trace, TRACE_STREAM_MS, NULL);
+#endif
+#if LVGL_TASK
+    // From here on, only the LVGL task calls LVGL
+    if (xTaskCreatePinnedToCore(lvgl_task, "lvgl", LVGL_TASK_STACK, NULL, LVGL_TASK_PRIORITY, &lvgl_task_handle,
+                                LVGL_TASK_CORE) != pdPASS)
+        Serial.println("LVGL task creation failed, LVGL runs in loop()");
+#endif
+    TRACE_END("setup");
 }
 
 void loop()
 {
-    lv_timer_handler(); /* let LVGL do its GUI work */
+#if LVGL_TASK
+    if (lvgl_task_handle)
+        vTaskDelete(NULL); // the LVGL task does the work of loop()
+#endif
+    lvgl_service(0); /* let LVGL do its GUI work */
+#if TE_SYNC
+    if (te_paced)
+    {
+        // One frame per panel refresh, started when the scan has just left the last line
+        amoled.waitTearingEffect(100);
+        if (!panel_asleep)
+            lv_refr_now(disp);
+        return;
+    }
+#endif
     delay(5);
 }
 
+// Runs the LVGL timers after what woke the service up (LVGL_WAKE_* bits), returns the time until the next one is due (ms)
+uint32_t lvgl_service(uint32_t wake)
+{
+    // How late the timers run: the wakeup compared with the deadline returned last time
+    static int64_t due_us = -1;
+    const int64_t now = esp_timer_get_time();
+    lvgl_stats.wakeups++;
+    if (due_us >= 0 && now > due_us)
+    {
+        const uint32_t late = (uint32_t)(now - due_us);
+        lvgl_stats.late_count++;
+        lvgl_stats.late_sum_us += late;
+        if (late > lvgl_stats.late_max_us)
+            lvgl_stats.late_max_us = late;
+    }
+
+    // Read a touch right away rather than at the next poll of the touchpad
+    if (wake & LVGL_WAKE_INPUT)
+    {
+        lvgl_stats.input++;
+        lv_indev_read(indev);
+    }
+    // Move the bubble with the sample that has just been read
+    if (wake & LVGL_WAKE_IMU)
+    {
+        lvgl_stats.imu++;
+        if (bubble_timer)
+            lv_timer_ready(bubble_timer);
+    }
+    // A fade step held back while the frame was on the bus goes out now (Amoled::updateBrightness)
+    if (wake & LVGL_WAKE_FLUSH)
+    {
+        lvgl_stats.flush++;
+        amoled.updateBrightness();
+    }
+
+    const uint32_t next = lv_timer_handler();
+    due_us = (next == LV_NO_TIMER_READY) ? -1 : esp_timer_get_time() + (int64_t)next * 1000;
+    return next;
+}
+
+#if LVGL_TASK
+// The LVGL task: sleeps until the next LVGL timer is due or until it is notified
+void lvgl_task(void *arg)
+{
+    LV_UNUSED(arg);
+    uint32_t wake = 0;
+    for (;;)
+    {
+        const uint32_t next = lvgl_service(wake);
+        wake = 0;
+#if TE_SYNC
+        if (te_paced)
+        {
+            // One frame per panel refresh, started when the scan has just left the last line
+            amoled.waitTearingEffect(100);
+            xTaskNotifyWait(0, UINT32_MAX, &wake, 0);
+            if (!panel_asleep)
+                lv_refr_now(disp);
+            continue;
+        }
+#endif
+        const TickType_t ticks = (next == LV_NO_TIMER_READY) ? portMAX_DELAY : pdMS_TO_TICKS(next);
+        xTaskNotifyWait(0, UINT32_MAX, &wake, ticks);
+    }
+}
+#endif
+
+// Wakes the LVGL task up, from a task or an ISR
+void lvgl_wake(uint32_t bits)
+{
+    if (!lvgl_task_handle)
+        return; // LVGL runs in loop()
+    if (xPortInIsrContext())
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(lvgl_task_handle, bits, eSetBits, &woken);
+        if (woken)
+            portYIELD_FROM_ISR();
+    }
+    else
+        xTaskNotify(lvgl_task_handle, bits, eSetBits);
+}
+
+// Board step: wait for a serial monitor on the USB port (Serial is always true on a UART), nothing depends on it
+bool wait_serial(void *user_ctx)
+{
+    LV_UNUSED(user_ctx);
+    while (!Serial && millis() < SERIAL_WAIT_MS)
+        delay(10);
+    return true;
+}
+
+// Board step: touch controller, it also installs the I2C bus driver
+bool init_touch(void *user_ctx)
+{
+    LV_UNUSED(user_ctx);
+    Touch_Init();
+#if PIN_NUM_TOUCH_INT >= 0
+    pinMode(PIN_NUM_TOUCH_INT, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(PIN_NUM_TOUCH_INT), touch_isr, FALLING);
+#endif
+    return true;
+}
+
+#if PIN_NUM_TOUCH_INT >= 0
+// The FT3168 pulls its interrupt line low when it has a touch to report
+void ARDUINO_ISR_ATTR touch_isr()
+{
+    lvgl_wake(LVGL_WAKE_INPUT);
+}
+#endif
+
+// Board step: QMI8658 6-axis IMU, its on-demand calibration takes about 1.5 s
+bool init_imu(void *user_ctx)
+{
+    LV_UNUSED(user_ctx);
+    if (!qmi8658_init())
+        return false;
+    // Polled instead of the fixed delay the QMI8658 needed after init: the first samples are there
+    if (!qmi8658_wait_data_ready(1000))
+        return false;
+#ifdef USE_BUILT_IN_SURFACE_LEVEL_EXAMPLE
+    // Create the task to read QMI8658 6-axis IMU (3-axis accelerometer and 3-axis gyroscope)
+    xTaskCreatePinnedToCore(imu_task, "imu", 4096, NULL, 2, NULL, 0);
+#endif
+    return true;
+}
+
+// Board step: reset and init sequence of the display, the init tables end with the panel on
+bool init_panel(void *user_ctx)
+{
+    LV_UNUSED(user_ctx);
+    return amoled.begin();
+}
+
+// Board step: LVGL draw buffers of DRAW_BUF_STRATEGY
+bool alloc_lvgl_buffers(void *user_ctx)
+{
+    LV_UNUSED(user_ctx);
+    return draw_buffers.alloc(draw_buf_strategies[DRAW_BUF_STRATEGY]);
+}
+
+void print_line(const char *line)
+{
+    Serial.println(line);
+}
+
+// Periodic LVGL timer, deletes itself once the boot timeline is printed
+void print_boot_timeline(lv_timer_t *timer)
+{
+    if (!board.done(boot_steps))
+        return;
+    board.printTimeline(print_line);
+    lv_timer_delete(timer);
+}
+
+// The change timed by the benchmarks besides full-screen frames: the bubble moved by a few pixels
+void bench_change(int frame, void *ctx)
+{
+    LV_UNUSED(ctx);
+#ifdef USE_BUILT_IN_SURFACE_LEVEL_EXAMPLE
+    if (uic_bubble)
+    {
+        lv_obj_set_x(uic_bubble, lv_obj_get_x(uic_bubble) + ((frame & 1) ? -6 : 6));
+        return;
+    }
+#endif
+    LV_UNUSED(frame);
+    lv_obj_invalidate(lv_screen_active());
+}
+
+#ifdef RENDER_BENCH
+// LVGL timer, once the board is up: the rendering benchmark of the draw buffers in use, then it deletes itself
+void render_bench(lv_timer_t *timer)
+{
+    if (!board.done(boot_steps))
+        return;
+    lv_timer_delete(timer);
+    TRACE_SCOPE("render bench");
+    DrawBufferResult r;
+    draw_buffers.tune(disp, draw_buffers.strategy(), 1, SIZE_MAX, SIZE_MAX, &r, RENDER_BENCH_FRAMES, bench_change);
+    Serial.printf("Render bench, %d draw unit(s), %s, us per frame: full screen %lu (%lu with the panel), "
+                  "bubble %lu (%lu with the panel)\n",
+                  LV_DRAW_SW_DRAW_UNIT_CNT, draw_buffers.strategy()->name, (unsigned long)r.render_us,
+                  (unsigned long)r.frame_us, (unsigned long)r.change_render_us, (unsigned long)r.change_frame_us);
+}
+#endif
+
+#if TRACE_EVENTS
+// Periodic LVGL timer to send the events traced since the last call, in binary frames (trace.h)
+void stream_trace(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+    static uint8_t frame[1024];
+    size_t n;
+    while ((n = trace_drain(frame, sizeof(frame))) > 0)
+        Serial.write(frame, n);
+}
+#endif
+
 // LVGL calls this function to read the touchpad
 void lvgl_touchpad_read(lv_indev_t *indev, lv_indev_data_t *data)
 {
+    TRACE_SCOPE("touchpad read");
     uint16_t tp_x = 0, tp_y = 0;
-    uint8_t win = getTouch(&tp_x, &tp_y);
+    // The I2C bus is not installed until the touch step is done
+    uint8_t win = board.done(touch_step) && !board.failed(touch_step) && getTouch(&tp_x, &tp_y);
     if (win)
     {
         data->point.x = tp_x;
@@ -168,12 +570,175 @@ uint32_t millis_cb(void)
 // LVGL calls this function when a rendered image needs to copied to the display
 void my_disp_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
 {
-    // Serial.printf("x1=%d, y1=%d, x2=%d, y2=%d\n",area->x1, area->y1, area->x2, area->y2);
-    amoled.drawArea(area->x1, area->y1, area->x2, area->y2, (uint16_t *)px_map);
+    TRACE_SCOPE("flush");
+#ifdef PRINT_FLUSH_TRACE
+    Serial.printf("area %d %d %d %d\n", (int)area->x1, (int)area->y1, (int)area->x2, (int)area->y2);
+    if (lv_display_flush_is_last(disp))
+        Serial.println("frame");
+#endif
+    // Returns once the area is queued, my_disp_flush_done tells LVGL when it has left the bus.
+    // A band of one color was never rendered into px_map (SOLID_FILL_UNIT).
+    // In DIRECT render mode px_map is the whole screen, and the area a window of it
+    uint16_t color;
+    if (fill_unit.take(area, &color))
+        amoled.fillArea(area->x1, area->y1, area->x2, area->y2, color);
+    else if (disp->render_mode == LV_DISPLAY_RENDER_MODE_DIRECT)
+        amoled.drawArea(area->x1, area->y1, area->x2, area->y2,
+                        (uint16_t *)px_map + area->y1 * DISPLAY_WIDTH + area->x1, DISPLAY_WIDTH);
+    else
+        amoled.drawArea(area->x1, area->y1, area->x2, area->y2, (uint16_t *)px_map);
+    if (lv_display_flush_is_last(disp))
+        amoled.endFrame(); // no-op unless FLUSH_PROFILE is enabled
+#if FLUSH_PROFILE && defined(PRINT_FLUSH_CSV)
+    print_flush_csv();
+#endif
+}
 
+// The display driver calls this function (from the SPI interrupt) when the last pixel of a flushed area has been sent
+void my_disp_flush_done(void *user_ctx)
+{
+    TRACE_INSTANT("flush done");
+    lv_display_t *disp = (lv_display_t *)user_ctx;
+    const bool last = lv_display_flush_is_last(disp);
     lv_display_flush_ready(disp);
+    if (last)
+        lvgl_wake(LVGL_WAKE_FLUSH);
+    // Also called from the task on a failed or empty flush
+    if (xPortInIsrContext())
+    {
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(flush_done_sem, &woken);
+        if (woken)
+            portYIELD_FROM_ISR();
+    }
+    else
+        xSemaphoreGive(flush_done_sem);
+}
+
+// LVGL calls this function when it needs the buffer of the area in flight. Blocking instead of spinning
+// leaves the core to the other tasks (LVGL's draw thread, the IMU task); the timeout only covers a flush
+// done given before the wait, from an earlier area
+void my_disp_flush_wait(lv_display_t *disp)
+{
+    while (disp->flushing)
+        xSemaphoreTake(flush_done_sem, pdMS_TO_TICKS(5));
 }
 
+// Periodic LVGL timer to step the brightness fades (Amoled::fadeBrightness), with 2-byte panel commands instead of redraws
+void update_brightness(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+    amoled.updateBrightness();
+}
+
+#ifdef USE_POWER_POLICY
+// Power mode of the panel after `inactive_ms` without a touch
+uint8_t power_policy(uint32_t inactive_ms, void *user_ctx)
+{
+    LV_UNUSED(user_ctx);
+#ifdef POWER_SLEEP_AFTER_MS
+    if (inactive_ms >= POWER_SLEEP_AFTER_MS)
+        return AMOLED_POWER_SLEEP;
+#endif
+#ifdef POWER_IDLE_AFTER_MS
+    if (inactive_ms >= POWER_IDLE_AFTER_MS)
+        return AMOLED_POWER_IDLE;
+#endif
+    return AMOLED_POWER_NORMAL;
+}
+
+// Periodic LVGL timer to apply the power policy. While the panel sleeps the refresh timer is paused,
+// otherwise the next flush would wake it; the areas invalidated meanwhile are drawn on wake.
+void update_power(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+    const bool asleep = amoled.updatePower(lv_display_get_inactive_time(disp)) & AMOLED_POWER_SLEEP;
+    if (asleep == panel_asleep)
+        return;
+    panel_asleep = asleep;
+#if TE_SYNC
+    if (te_paced)
+        return; // loop() renders, and checks panel_asleep
+#endif
+    if (asleep)
+        lv_timer_pause(lv_display_get_refr_timer(disp));
+    else
+        lv_timer_resume(lv_display_get_refr_timer(disp));
+}
+#endif
+
+#ifdef SHOW_LVGL_TASK_STATS
+// Periodic LVGL timer to print the wakeups of LVGL per second and how late its timers ran
+void print_lvgl_stats(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+    static int64_t since = esp_timer_get_time();
+    const int64_t now = esp_timer_get_time();
+    const LvglServiceStats st = lvgl_stats;
+    lvgl_stats = {};
+    const float s = (now - since) / 1e6f;
+    since = now;
+    Serial.printf("LVGL %s: %.1f wakeups/s (touch %lu, IMU %lu, frame done %lu), timers late %lu times, avg %lu us, max %lu us\n",
+                  lvgl_task_handle ? "task" : "loop", st.wakeups / s, (unsigned long)st.input, (unsigned long)st.imu,
+                  (unsigned long)st.flush, (unsigned long)st.late_count,
+                  (unsigned long)(st.late_count ? st.late_sum_us / st.late_count : 0), (unsigned long)st.late_max_us);
+}
+#endif
+
+#ifdef SHOW_FLUSH_STATS
+// Periodic LVGL timer to print how many pixel bytes were staged (copied), sent to the panel, clipped away
+// or skipped because the panel already held them
+void print_flush_stats(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+    const AmoledFlushStats &st = amoled.flushStats();
+    Serial.printf("Flush: %lu areas (%lu zero-copy, %lu filled), %lu transfers in %lu windows, %lu bytes copied, %lu bytes sent, %lu bytes clipped, %lu bytes unchanged\n",
+                  (unsigned long)st.flushes, (unsigned long)st.zero_copy_flushes, (unsigned long)st.fill_flushes,
+                  (unsigned long)st.transfers, (unsigned long)st.windows,
+                  (unsigned long)st.bytes_copied, (unsigned long)st.bytes_sent, (unsigned long)st.bytes_clipped,
+                  (unsigned long)st.bytes_unchanged);
+    amoled.resetFlushStats();
+#ifdef SOLID_FILL_UNIT
+    const FillUnitStats &fs = fill_unit.stats();
+    Serial.printf("Fill unit: %lu fills claimed, %lu bands sent without rendering, %lu rendered after all\n",
+                  (unsigned long)fs.claimed, (unsigned long)fs.sent, (unsigned long)fs.rendered);
+    fill_unit.resetStats();
+#endif
+}
+#endif
+
+#if FLUSH_PROFILE && defined(PRINT_FLUSH_CSV)
+// One line per frame once all its flushes are done (frames are only published from here, so a
+// line may come one frame late, and frames that complete together are only printed once)
+void print_flush_csv()
+{
+    static uint32_t printed = 0;
+    const uint32_t count = amoled.frameCount();
+    if (count == printed)
+        return;
+    printed = count;
+    const AmoledFrameProfile &f = amoled.frameProfile();
+    Serial.printf("%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", (unsigned long)count,
+                  (unsigned long)f.flushes, (unsigned long)f.sum.transfers, (unsigned long)f.sum.windows,
+                  (unsigned long)f.sum.bytes_sent, (unsigned long)f.sum.pad_bytes, (unsigned long)f.sum.filler_bytes,
+                  (unsigned long)f.sum.stage_us, (unsigned long)f.sum.wait_us, (unsigned long)f.sum.call_us,
+                  (unsigned long)(f.flushes ? f.sum.latency_us / f.flushes : 0), (unsigned long)f.latency_max_us,
+                  (unsigned long)f.frame_us, (unsigned long)f.period_us);
+}
+#endif
+
+#if FLUSH_PROFILE && defined(SHOW_FLUSH_HUD)
+// Periodic LVGL timer to show the profile of the last frame
+void show_flush_hud(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+    const AmoledFrameProfile &f = amoled.frameProfile();
+    lv_label_set_text_fmt(flush_hud, "%lu flushes %lu KB\nframe %lu us / %lu us\nstage %lu wait %lu us",
+                          (unsigned long)f.flushes, (unsigned long)(f.sum.bytes_sent / 1024), (unsigned long)f.frame_us,
+                          (unsigned long)f.period_us, (unsigned long)f.sum.stage_us, (unsigned long)f.sum.wait_us);
+}
+#endif
+
 // LVGL display rounder callback for CO5300 (a kind of patch for LVGL 9)
 static void rounder_event_cb(lv_event_t *e)
 {
@@ -192,6 +757,29 @@ static void rounder_event_cb(lv_event_t *e)
     }
 }
 
+#ifdef COALESCE_DIRTY_AREAS
+// LVGL invalidate area callback, after the rounder: the area grows into the union of the areas of
+// this frame it pays to merge it with, LVGL then joins the ones it covers into it. The frame starts
+// over once it is rendered
+static void coalesce_event_cb(lv_event_t *e)
+{
+    static CoalesceRect frame[COALESCE_MAX_AREAS];
+    static int n = 0;
+    if (lv_event_get_code(e) == LV_EVENT_RENDER_START)
+    {
+        n = 0;
+        return;
+    }
+    lv_area_t *area = (lv_area_t *)lv_event_get_param(e);
+    if (area)
+    {
+        CoalesceRect a = {area->x1, area->y1, area->x2, area->y2};
+        n = coalesce_add(frame, n, a);
+        lv_area_set(area, a.x1, a.y1, a.x2, a.y2);
+    }
+}
+#endif
+
 #ifdef USE_BUILT_IN_SURFACE_LEVEL_EXAMPLE
 // Below are all the functions need by the Surface Level example
 
@@ -202,8 +790,10 @@ static void imu_task(void *arg)
     {
         float acc[3], gyro[3];
         float temp = 0;
+        TRACE_BEGIN("imu read");
         qmi8658_read_xyz(acc, gyro);
         temp = qmi8658_readTemp();
+        TRACE_END("imu read");
         g_imu.ax = acc[0];
         g_imu.ay = acc[1];
         g_imu.az = acc[2];
@@ -211,6 +801,10 @@ static void imu_task(void *arg)
         g_imu.gy = gyro[1];
         g_imu.gz = gyro[2];
         g_imu.temp = temp;
+        // The bubble moves with every MOVE_BUBBLE_INTERVAL_MS / READ_SAMPLE_INTERVAL_MS samples
+        static uint32_t samples = 0;
+        if (++samples % (MOVE_BUBBLE_INTERVAL_MS / READ_SAMPLE_INTERVAL_MS) == 0)
+            lvgl_wake(LVGL_WAKE_IMU);
 
         vTaskDelay(pdMS_TO_TICKS(READ_SAMPLE_INTERVAL_MS));
     }
@@ -220,6 +814,7 @@ static void imu_task(void *arg)
 void move_bubble(lv_timer_t *timer)
 {
     LV_UNUSED(timer);
+    TRACE_SCOPE("move bubble");
     if (!uic_bubble)
         return; // UI not ready yet
 